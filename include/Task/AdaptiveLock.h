@@ -0,0 +1,251 @@
+#pragma once
+
+#include "Types/Forward.hpp"
+#include "Utils/Simd.hpp"
+#include "async_simple/Executor.h"
+#include <atomic>
+#include <coroutine>
+#include <mutex>
+#include <thread>
+
+// lock which spins briefly and then parks the thread on a futex (atomic wait), or suspends the awaiting coroutine
+// waiters are queued in FIFO order, unlock hands the lock over to the first waiter directly
+namespace punk
+{
+    inline void cpu_relax() noexcept
+    {
+#if defined(PUNK_ARCH_X64)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // counted on the slow paths only, the uncontended lock costs no extra atomic operation
+    struct lock_contention_stats
+    {
+        uint64_t    contended_count;    // acquisitions which found the lock held
+        uint64_t    parked_count;       // threads parked after spinning
+        uint64_t    suspended_count;    // coroutines suspended after spinning
+    };
+
+    class adaptive_lock
+    {
+    private:
+        struct waiter_t
+        {
+            waiter_t*                   next = nullptr;
+            std::coroutine_handle<>     continuation;           // null for a parked thread
+            async_simple::Executor*     executor = nullptr;     // resumes the coroutine, inline if null
+            std::atomic<uint32_t>       signaled = 0;
+        };
+
+        // state_ is unlocked_state, locked_state, or the newest waiter queued since the holder last looked
+        static constexpr uintptr_t unlocked_state = 1;
+        static constexpr uintptr_t locked_state = 0;
+
+        std::atomic<uintptr_t>      state_ = unlocked_state;
+        waiter_t*                   waiters_ = nullptr;     // FIFO of waiters, only touched by the holder
+        uint32_t                    spin_count_;
+        std::atomic<uint64_t>       contended_count_ = 0;
+        std::atomic<uint64_t>       parked_count_ = 0;
+        std::atomic<uint64_t>       suspended_count_ = 0;
+
+    public:
+        class lock_awaiter
+        {
+        protected:
+            adaptive_lock&  lock_;
+            waiter_t        waiter_;
+
+        public:
+            lock_awaiter(adaptive_lock& lock, async_simple::Executor* executor) noexcept
+                : lock_(lock)
+            {
+                waiter_.executor = executor;
+            }
+
+            // async_simple's await_transform takes the awaiter by value, it is only moved before it is awaited
+            lock_awaiter(lock_awaiter&& other) noexcept
+                : lock_(other.lock_)
+            {
+                waiter_.executor = other.waiter_.executor;
+            }
+
+            bool await_ready() noexcept
+            {
+                return lock_.try_lock() || lock_.spin_lock();
+            }
+
+            bool await_suspend(std::coroutine_handle<> continuation) noexcept
+            {
+                // the awaiter may be gone once queued, the coroutine can be resumed by then
+                auto& lock = lock_;
+                waiter_.continuation = continuation;
+                if(lock.enqueue(&waiter_))
+                {
+                    return false;
+                }
+                lock.suspended_count_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        class scoped_lock_awaiter : public lock_awaiter
+        {
+        public:
+            using lock_awaiter::lock_awaiter;
+
+            std::unique_lock<adaptive_lock> await_resume() const noexcept
+            {
+                return std::unique_lock<adaptive_lock>{ this->lock_, std::adopt_lock };
+            }
+        };
+
+    public:
+        explicit adaptive_lock(uint32_t spin_count = 128) noexcept
+            : spin_count_(spin_count) {}
+
+        adaptive_lock(adaptive_lock const&) = delete;
+        adaptive_lock& operator=(adaptive_lock const&) = delete;
+
+        ~adaptive_lock()
+        {
+            assert(state_.load(std::memory_order_relaxed) == unlocked_state);
+        }
+
+        bool try_lock() noexcept
+        {
+            auto expected = unlocked_state;
+            return state_.compare_exchange_strong(expected, locked_state, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void lock() noexcept
+        {
+            if(try_lock() || spin_lock())
+            {
+                return;
+            }
+
+            // each thread waits for one lock at a time, so its waiter outlives any late wake up
+            thread_local waiter_t thread_waiter;
+            thread_waiter.signaled.store(0, std::memory_order_relaxed);
+            if(enqueue(&thread_waiter))
+            {
+                return;
+            }
+            parked_count_.fetch_add(1, std::memory_order_relaxed);
+            while(thread_waiter.signaled.load(std::memory_order_acquire) == 0)
+            {
+                thread_waiter.signaled.wait(0, std::memory_order_acquire);
+            }
+        }
+
+        void unlock() noexcept
+        {
+            auto* waiter = waiters_;
+            if(!waiter)
+            {
+                auto expected = locked_state;
+                if(state_.compare_exchange_strong(expected, unlocked_state, std::memory_order_release, std::memory_order_relaxed))
+                {
+                    return;
+                }
+
+                // take the waiters queued since, and reverse them into FIFO order
+                auto* newest = reinterpret_cast<waiter_t*>(state_.exchange(locked_state, std::memory_order_acquire));
+                while(newest)
+                {
+                    auto* next = newest->next;
+                    newest->next = waiter;
+                    waiter = newest;
+                    newest = next;
+                }
+            }
+
+            // the lock stays held & passes to the waiter
+            waiters_ = waiter->next;
+            wake(waiter);
+        }
+
+        // co_await lock.co_lock(), the coroutine owns the lock after resuming and must unlock it,
+        // a waiting coroutine is resumed on the executor if given, otherwise inline by the unlocking thread
+        lock_awaiter co_lock(async_simple::Executor* executor = nullptr) noexcept
+        {
+            return lock_awaiter{ *this, executor };
+        }
+
+        // auto scope = co_await lock.co_scoped_lock()
+        scoped_lock_awaiter co_scoped_lock(async_simple::Executor* executor = nullptr) noexcept
+        {
+            return scoped_lock_awaiter{ *this, executor };
+        }
+
+        lock_contention_stats get_contention_stats() const noexcept
+        {
+            return lock_contention_stats
+            {
+                .contended_count = contended_count_.load(std::memory_order_relaxed),
+                .parked_count = parked_count_.load(std::memory_order_relaxed),
+                .suspended_count = suspended_count_.load(std::memory_order_relaxed),
+            };
+        }
+
+    private:
+        bool spin_lock() noexcept
+        {
+            contended_count_.fetch_add(1, std::memory_order_relaxed);
+            for(uint32_t loop = 0; loop < spin_count_; ++loop)
+            {
+                cpu_relax();
+                if(state_.load(std::memory_order_relaxed) == unlocked_state && try_lock())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // returns true if the lock was released meanwhile & is acquired instead of queueing
+        bool enqueue(waiter_t* waiter) noexcept
+        {
+            auto state = state_.load(std::memory_order_relaxed);
+            for(;;)
+            {
+                if(state == unlocked_state)
+                {
+                    if(state_.compare_exchange_weak(state, locked_state, std::memory_order_acquire, std::memory_order_relaxed))
+                    {
+                        return true;
+                    }
+                    continue;
+                }
+
+                waiter->next = reinterpret_cast<waiter_t*>(state);
+                if(state_.compare_exchange_weak(state, reinterpret_cast<uintptr_t>(waiter), std::memory_order_release, std::memory_order_relaxed))
+                {
+                    return false;
+                }
+            }
+        }
+
+        static void wake(waiter_t* waiter) noexcept
+        {
+            if(auto continuation = waiter->continuation)
+            {
+                // the waiter may be gone once resumed
+                auto* executor = waiter->executor;
+                if(!executor || !executor->schedule([continuation]() { continuation.resume(); }))
+                {
+                    continuation.resume();
+                }
+                return;
+            }
+
+            waiter->signaled.store(1, std::memory_order_release);
+            waiter->signaled.notify_one();
+        }
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Types/Forward.hpp"
+#include "async_simple/coro/Lazy.h"
+
+// coroutine frames of the engine come from size-bucketed thread-local pools instead of the global heap
+namespace punk
+{
+    // frames up to max_pooled_frame_size are pooled, each thread caches freed frames of its own,
+    // a frame can be freed on any thread, it simply joins the cache of that thread
+    inline constexpr size_t min_pooled_frame_size = 64;
+    inline constexpr size_t max_pooled_frame_size = 4096;
+
+    void* allocate_coroutine_frame(size_t size);
+    void deallocate_coroutine_frame(void* frame, size_t size) noexcept;
+
+    // async_simple Lazy with a pooled coroutine frame, awaitable & schedulable just as async_simple::coro::Lazy
+    template <typename T = void>
+    class [[nodiscard]] Lazy : public async_simple::coro::Lazy<T>
+    {
+    public:
+        using base_type = async_simple::coro::Lazy<T>;
+
+        struct promise_type : public base_type::promise_type
+        {
+            static void* operator new(size_t size)
+            {
+                return allocate_coroutine_frame(size);
+            }
+
+            static void operator delete(void* frame, size_t size) noexcept
+            {
+                deallocate_coroutine_frame(frame, size);
+            }
+
+            // the frame holds this promise type, which only adds the allocation functions to the base promise
+            Lazy get_return_object() noexcept
+            {
+                return Lazy{ base_type::promise_type::get_return_object() };
+            }
+        };
+
+        // async_simple addresses the frame through coroutine_handle<base promise_type>, which is only valid
+        // while the promise adds no state that moves the base promise within the frame
+        static_assert(sizeof(promise_type) == sizeof(typename base_type::promise_type) &&
+            alignof(promise_type) == alignof(typename base_type::promise_type), "the pooled promise must keep the base promise layout");
+
+    public:
+        explicit Lazy(base_type&& lazy) noexcept
+            : base_type(std::move(lazy)) {}
+    };
+}
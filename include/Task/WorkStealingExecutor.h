@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Types/Meta.h"
+#include "async_simple/Executor.h"
+
+// work-stealing executor of the engine, both coroutines resumed by async_simple and chunk jobs run on it
+// each worker owns a Chase-Lev deque, tasks scheduled from a worker go to its own deque & are stolen by idle workers,
+// tasks scheduled from other threads go to a shared injection queue, workers out of work park on an atomic wait (futex)
+namespace punk
+{
+    struct work_stealing_executor_options
+    {
+        uint32_t                worker_count = 0;       // 0 for the size of the core set, or the hardware concurrency without one
+        bool                    pin_workers = false;    // pin worker i to cores[i % size], or to logical core i % core count without a core set
+        std::vector<uint32_t>   cores;                  // logical cores of the executor partition, empty for all the cores
+        uint32_t                spin_count = 64;        // steal rounds before a worker parks
+        std::string             name = "punk";
+    };
+
+    class work_stealing_executor : public async_simple::Executor
+    {
+    protected:
+        explicit work_stealing_executor(std::string name)
+            : async_simple::Executor(std::move(name)) {}
+
+    public:
+        virtual ~work_stealing_executor() = default;
+
+        // factory, the workers are started here & joined on shutdown after draining the pending tasks
+        static work_stealing_executor* create_instance(work_stealing_executor_options const& options = {});
+
+    public:
+        virtual uint32_t get_worker_count() const = 0;
+
+        // index of the worker running the calling thread, invalid_index_value() outside the executor
+        virtual uint32_t get_current_worker_index() const = 0;
+
+        // idle workers of this executor borrow tasks from the neighbor once they are out of their own work,
+        // and the neighbor wakes a parked worker of this executor when none of its own is parked,
+        // neighbors are linked from one thread, up to 64 each, shut all of them down before destroying any
+        virtual void add_neighbor(work_stealing_executor* neighbor) = 0;
+
+        // runs the pending tasks, joins the workers & stops lending to the borrowers, called by the destructor as well
+        virtual void shutdown() = 0;
+    };
+}
@@ -16,6 +16,9 @@ namespace punk
 
     struct data_component_tag;
     struct cow_component_tag;
+
+    // opt-in AoSoA layout of a component with only arithmetic fields: using component_layout = lane_blocked_layout_tag;
+    struct lane_blocked_layout_tag;
 }
 
 // for primative types
@@ -65,6 +68,11 @@ namespace punk
             return uint32_t{ 0 };
         }
 
+        static constexpr bool is_arithmetic() noexcept
+        {
+            return std::is_arithmetic_v<type>;
+        }
+
         static uint32_t get_hash()
         {
             auto const type_name = get_type_name();
@@ -112,6 +120,19 @@ namespace punk
             }
         }
 
+        static constexpr bool is_lane_blocked() noexcept
+        {
+            if constexpr(has_component_layout<type>)
+            {
+                static_assert(std::is_same_v<traits_component_layout_t<type>, lane_blocked_layout_tag>);
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
         static auto get_component_group() -> std::conditional_t<has_component_group<type>, traits_component_group_t<type>, type>;
     };
 
@@ -33,6 +33,7 @@ namespace punk
     PUNK_TRAITS_MEMBER_TYPE(value_type);
     PUNK_TRAITS_MEMBER_TYPE(component_tag);
     PUNK_TRAITS_MEMBER_TYPE(component_group)
+    PUNK_TRAITS_MEMBER_TYPE(component_layout);
 
     template <typename T, typename S>
     constexpr auto owner_type_of_pmd(T S::*) noexcept -> T;
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Types/Meta.h"
+
+// chunk memory of one world, the address space of all chunks is reserved up front and committed block by block,
+// the committed pages are bound to a numa node, so the chunks stay local to the cores of the world that touch them
+namespace punk
+{
+    class chunk_allocator
+    {
+    public:
+        static constexpr uint32_t chunks_per_block = 64;
+        static constexpr size_t default_max_chunk_count = size_t{ 1 } << 16;
+
+    protected:
+        chunk_allocator() = default;
+
+    public:
+        chunk_allocator(chunk_allocator const&) = delete;
+        chunk_allocator& operator=(chunk_allocator const&) = delete;
+        chunk_allocator(chunk_allocator&&) = delete;
+        chunk_allocator& operator=(chunk_allocator&&) = delete;
+        virtual ~chunk_allocator() = default;
+
+        // factory, numa_node is invalid_index_value() to leave the placement to the first touch
+        static chunk_allocator* create_instance(uint32_t numa_node = invalid_index_value(), size_t max_chunk_count = default_max_chunk_count);
+
+    public:
+        // a zero filled chunk of chunk_memory_size bytes, nullptr when the reserved range is exhausted, thread safe
+        virtual chunk_t* allocate_chunk() = 0;
+        virtual void deallocate_chunk(chunk_t* chunk) = 0;
+
+        virtual uint32_t get_numa_node() const = 0;
+        virtual size_t get_allocated_chunk_count() const = 0;
+        virtual size_t get_committed_chunk_count() const = 0;
+    };
+}
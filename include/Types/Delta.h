@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Types/RTTI.h"
+#include "Types/ErrorCode.hpp"
+#include <span>
+
+// per-field delta of component states against a baseline
+// the type is flattened to its leaf fields, an element is encoded as
+//   change mask (1 bit per leaf field) | changed leaf values
+// arithmetic leaves are encoded as the varint of (baseline xor current), which is short for small changes,
+// the other leaves as raw bytes
+// a column is encoded as an element change mask followed by the delta of each changed element
+namespace punk
+{
+    class delta_codec
+    {
+    public:
+        delta_codec() = default;
+        virtual ~delta_codec() = default;
+        delta_codec(delta_codec const&) = delete;
+        delta_codec& operator=(delta_codec const&) = delete;
+        delta_codec(delta_codec&&) = delete;
+        delta_codec& operator=(delta_codec&&) = delete;
+
+        // factory, nullptr for the types with a non-trivial copy or destructor, their bytes can not be patched in place
+        static delta_codec* create_instance(type_info_t const* type_info);
+
+        template <typename T>
+        static delta_codec* create_instance(runtime_type_system* rtt_system)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "the delta of a type is applied byte-wise");
+            assert(rtt_system);
+            return create_instance(rtt_system->get_or_create_type_info<T>());
+        }
+
+    public:
+        virtual type_info_t const* get_type_info() const = 0;
+        virtual uint32_t get_leaf_field_count() const = 0;
+
+        // append the delta of current against baseline to out, returns false if nothing changed
+        virtual bool encode(void const* baseline, void const* current, std::vector<uint8_t>& out) const = 0;
+
+        // apply the delta at the front of data onto baseline, result may alias baseline
+        // consumed is set to the count of bytes read
+        virtual error_code decode(void const* baseline, void* result, std::span<uint8_t const> data, size_t& consumed) const = 0;
+
+        // column version of interfaces, both columns share the element count and lane width
+        virtual bool encode_column(void const* baseline, void const* current, uint32_t element_count, uint32_t lane_width, std::vector<uint8_t>& out) const = 0;
+        virtual error_code decode_column(void const* baseline, void* result, uint32_t element_count, uint32_t lane_width, std::span<uint8_t const> data, size_t& consumed) const = 0;
+
+    public: // generic version of interfaces
+        template <typename T>
+        bool encode(T const& baseline, T const& current, std::vector<uint8_t>& out) const
+        {
+            assert(sizeof(T) == get_type_size(get_type_info()));
+            return encode(static_cast<void const*>(&baseline), static_cast<void const*>(&current), out);
+        }
+
+        template <typename T>
+        error_code decode(T const& baseline, T& result, std::span<uint8_t const> data, size_t& consumed) const
+        {
+            assert(sizeof(T) == get_type_size(get_type_info()));
+            return decode(static_cast<void const*>(&baseline), static_cast<void*>(&result), data, consumed);
+        }
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <compare>
+#include "Types/Forward.hpp"
 #include "Types/Handle.hpp"
 
 namespace punk
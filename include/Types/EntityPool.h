@@ -1,9 +1,67 @@
 #pragma once
 
+#include "Types/Meta.h"
 #include "Types/Entity.hpp"
+#include "Types/ErrorCode.hpp"
+#include "Utils/DynamicBitset.hpp"
+#include <span>
 
 namespace punk
 {
+    // where the components of an entity are placed: (archetype, chunk, row)
+    struct entity_location_t
+    {
+        archetype_t*    archetype;
+        chunk_t*        chunk;
+        uint32_t        index_in_chunk;
+    };
+
+    // a range of fresh handles reserved by one worker thread,
+    // entities are minted from it with no shared writes, and committed to the pool at the next sync point
+    class entity_reservation
+    {
+    private:
+        uint32_t                first_index_;
+        uint32_t                count_;
+        uint32_t                used_count_;
+        entity_t::entity_tag    tag_;
+        entity_t::entity_version version_;
+
+    public:
+        constexpr entity_reservation() noexcept
+            : entity_reservation(entity_handle::invalid_handle_value(), 0, 0, 0) {}
+
+        constexpr entity_reservation(uint32_t first_index, uint32_t count, entity_t::entity_tag tag, entity_t::entity_version version) noexcept
+            : first_index_(first_index)
+            , count_(count)
+            , used_count_(0)
+            , tag_(tag)
+            , version_(version) {}
+
+        // fresh handles have never been used, so all minted entities share the initial version of the id space
+        entity_t mint() noexcept
+        {
+            if(exhausted())
+            {
+                return entity_t::invalid_entity();
+            }
+            return entity_t::compose(entity_handle{ first_index_ + used_count_++ }, tag_, version_);
+        }
+
+        bool exhausted() const noexcept
+        {
+            return used_count_ >= count_;
+        }
+
+        uint32_t get_first_index() const noexcept { return first_index_; }
+        uint32_t get_count() const noexcept { return count_; }
+        uint32_t get_used_count() const noexcept { return used_count_; }
+        entity_t::entity_tag get_tag() const noexcept { return tag_; }
+        entity_t::entity_version get_version() const noexcept { return version_; }
+    };
+
+    // each entity tag owns a separate id space, with its own handles, free list and location table,
+    // so operations on different tags never touch the same memory and can run concurrently
     class entity_pool
     {
     public:
@@ -14,12 +72,81 @@ namespace punk
         entity_pool(entity_pool&&) = delete;
         entity_pool& operator=(entity_pool&&) = delete;
 
-        static entity_pool* create_entity_pool();
+        // handles of a tag are limited to max_entities_per_tag, which sizes the address space reserved for its location table
+        static constexpr uint32_t default_max_entities_per_tag = 1u << 26;
+        static entity_pool* create_entity_pool(uint32_t max_entities_per_tag = default_max_entities_per_tag);
 
     public:
         virtual entity_t allocate_entity(uint16_t tag) = 0;
         virtual void deallocate_entity(entity_t entity) = 0;
-        virtual void is_alive(entity_t entity) = 0;
-        virtual entity_t restore_entity(entity_handle handle) = 0;
+        virtual bool is_alive(entity_t entity) const = 0;
+        virtual entity_t restore_entity(entity_handle handle, uint16_t tag = 0) const = 0;
+
+        // batched version of interfaces, one virtual call for the whole span
+        // allocate_entities returns the count of allocated entities, the rest of the span are filled with invalid entity
+        virtual size_t allocate_entities(std::span<entity_t> entities, uint16_t tag) = 0;
+        virtual void deallocate_entities(std::span<entity_t const> entities) = 0;
+        // bit i of the result is set when entities[i] is alive
+        virtual void are_alive(std::span<entity_t const> entities, dynamic_bitset<>& result) const = 0;
+
+        // reserve a range of fresh handles, lock-free & safe to call from any thread
+        virtual entity_reservation reserve_entities(uint32_t count, uint16_t tag) = 0;
+        // at the sync point: minted entities become alive, the unused handles go to the free list
+        virtual void commit_reservation(entity_reservation const& reservation) = 0;
+
+        // drop all the entities of a tag at once by releasing its id space,
+        // must be called at the sync point, entities of the tag allocated later never match the released ones
+        virtual void release_tag(uint16_t tag) = 0;
+
+        // location of an alive entity, nullptr for an expired one
+        virtual entity_location_t const* get_entity_location(entity_t entity) const = 0;
+        virtual error_code set_entity_location(entity_t entity, entity_location_t const& location) = 0;
+    };
+}
+
+namespace punk
+{
+    // per-thread minter, refills itself with reservations of block_size handles
+    class entity_minter
+    {
+    private:
+        entity_pool*                    pool_;
+        uint32_t                        block_size_;
+        uint16_t                        tag_;
+        std::vector<entity_reservation> reservations_;
+
+    public:
+        entity_minter(entity_pool* pool, uint16_t tag, uint32_t block_size = 256)
+            : pool_(pool)
+            , block_size_(block_size)
+            , tag_(tag)
+        {
+            assert(pool_);
+            assert(block_size_ > 0);
+        }
+
+        entity_t mint()
+        {
+            if(reservations_.empty() || reservations_.back().exhausted())
+            {
+                auto reservation = pool_->reserve_entities(block_size_, tag_);
+                if(reservation.get_count() == 0)
+                {
+                    return entity_t::invalid_entity();
+                }
+                reservations_.push_back(reservation);
+            }
+            return reservations_.back().mint();
+        }
+
+        // must be called at the sync point, when no thread is minting from this minter
+        void commit()
+        {
+            for(auto const& reservation : reservations_)
+            {
+                pool_->commit_reservation(reservation);
+            }
+            reservations_.clear();
+        }
     };
 }
\ No newline at end of file
@@ -11,5 +11,10 @@ namespace punk
         invalid_archetype           = -4,
         archetype_count_overflow    = -5,
         index_overflow              = -6,
+        snapshot_corrupted          = -7,
+        snapshot_version_mismatch   = -8,
+        snapshot_unsupported_type   = -9,
+        snapshot_archetype_mismatch = -10,
+        delta_corrupted             = -11,
     };
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Types/RTTI.h"
+#include "Types/EntityPool.h"
+#include "Types/ChunkAllocator.h"
+#include "Types/System.h"
+#include "Task/WorkStealingExecutor.h"
+#include "Utils/CpuTopology.hpp"
+#include <span>
+
+// one engine runs several game instances in the same process, each instance owns its world (entities & chunks),
+// its type & archetype registries, and an executor partition pinned to a core set on a single numa node,
+// with its chunk memory committed on that node, so an instance neither crosses the sockets nor shares cores with the others
+namespace punk
+{
+    // whom an idle partition borrows tasks from, borrowing across the sockets trades locality for throughput
+    enum class core_borrow_policy
+    {
+        none,
+        same_numa_node,
+        any_numa_node,
+    };
+
+    struct game_engine_options
+    {
+        uint32_t                    instance_count = 1;
+        std::vector<numa_node_info> topology;                   // empty to query the os
+        bool                        pin_workers = true;
+        bool                        numa_local_memory = true;   // commit the chunks of an instance on its numa node
+        core_borrow_policy          borrow_policy = core_borrow_policy::same_numa_node;
+        uint32_t                    spin_count = 64;
+        size_t                      max_chunk_count_per_instance = chunk_allocator::default_max_chunk_count;
+        uint32_t                    max_entities_per_tag = entity_pool::default_max_entities_per_tag;
+    };
+
+    class game_instance
+    {
+    protected:
+        game_instance() = default;
+
+    public:
+        game_instance(game_instance const&) = delete;
+        game_instance& operator=(game_instance const&) = delete;
+        game_instance(game_instance&&) = delete;
+        game_instance& operator=(game_instance&&) = delete;
+        virtual ~game_instance() = default;
+
+    public:
+        virtual uint32_t get_index() const = 0;
+        virtual uint32_t get_numa_node() const = 0;
+        virtual std::span<uint32_t const> get_cores() const = 0;
+
+        virtual work_stealing_executor* get_executor() = 0;
+        virtual runtime_type_system* get_type_system() = 0;
+        virtual runtime_archetype_system* get_archetype_system() = 0;
+        virtual entity_pool* get_entity_pool() = 0;
+        virtual chunk_allocator* get_chunk_allocator() = 0;
+        virtual system_scheduler* get_system_scheduler() = 0;
+    };
+
+    class game_engine
+    {
+    protected:
+        game_engine() = default;
+
+    public:
+        game_engine(game_engine const&) = delete;
+        game_engine& operator=(game_engine const&) = delete;
+        game_engine(game_engine&&) = delete;
+        game_engine& operator=(game_engine&&) = delete;
+        virtual ~game_engine() = default;
+
+        // factory, the instances & their executors are created here, all the executors are shut down before any instance is destroyed
+        static game_engine* create_instance(game_engine_options const& options = {});
+
+    public:
+        virtual uint32_t get_game_instance_count() const = 0;
+        virtual game_instance* get_game_instance(uint32_t index) = 0;
+        virtual std::span<numa_node_info const> get_numa_topology() const = 0;
+    };
+}
@@ -78,6 +78,8 @@ namespace punk
         uint32_t        field_count;
         component_tag_t component_tag;
         uint32_t        component_group;
+        bool            arithmetic;
+        bool            lane_blocked;
     };
 
     // create type info
@@ -112,8 +114,20 @@ namespace punk
     // get component group
     uint32_t get_type_component_group(type_info_t const* type_info);
 
+    // is arithmetic type
+    bool is_type_arithmetic(type_info_t const* type_info);
+
+    // does the component opt in to the lane-blocked layout
+    bool is_type_lane_blocked(type_info_t const* type_info);
+
     // set hash for fields
     void update_hash_for_fields(type_info_t* type_info);
+
+    // strict weak order of types by name hash, the names break the ties of name hash collisions
+    bool type_info_less(type_info_t const* lhs, type_info_t const* rhs);
+
+    // same name, size, alignment and field layout
+    bool is_type_layout_equal(type_info_t const* lhs, type_info_t const* rhs);
 }
 
 // interfaces for field_info_t
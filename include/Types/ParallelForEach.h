@@ -0,0 +1,222 @@
+#pragma once
+
+#include "Types/RTTI.h"
+#include "Types/ErrorCode.hpp"
+#include "async_simple/Executor.h"
+#include <atomic>
+#include <mutex>
+#include <span>
+
+// parallel iteration over the chunks matched by a query,
+// the chunk ranges are split into tasks of a target cost and run across the workers of an executor
+namespace punk
+{
+    // the chunks of a matched archetype, group_chunks[g] are the chunks of component group g in row order,
+    // all chunks of a group are full except the last one
+    struct archetype_chunks_t
+    {
+        archetype_t const*                          archetype;
+        std::vector<std::span<chunk_t* const>>      group_chunks;
+    };
+
+    // a component column inside one chunk, starting at the element first_index
+    struct column_ref_t
+    {
+        uint8_t*    data;
+        uint32_t    lane_width;
+        uint32_t    first_index;
+    };
+
+    // rows of an archetype which stay inside one chunk for every iterated component
+    struct chunk_segment_t
+    {
+        uint32_t    element_count;
+        uint32_t    first_column;       // index of the column of the first component in chunk_task_plan_t::columns
+    };
+
+    struct chunk_task_plan_t
+    {
+        std::vector<chunk_segment_t>    segments;
+        std::vector<column_ref_t>       columns;
+        std::vector<uint32_t>           task_offsets;   // task i runs the segments [task_offsets[i], task_offsets[i + 1])
+
+        size_t get_task_count() const noexcept
+        {
+            return task_offsets.empty() ? 0 : task_offsets.size() - 1;
+        }
+    };
+
+    struct parallel_for_options
+    {
+        uint32_t    target_task_cost = 16 * 1024;   // cost of the work in one task
+        uint32_t    cost_per_element = 1;           // estimated cost of the kernel on one element
+        uint32_t    max_task_count = 0;             // 0 for no limit
+    };
+
+    // split the rows of the chunks into segments & tasks of balanced element counts,
+    // every task but the last one takes a multiple of simd_width elements
+    error_code plan_chunk_tasks(std::span<archetype_chunks_t const> chunks, std::span<type_info_t const* const> component_types,
+        parallel_for_options const& options, chunk_task_plan_t& plan);
+
+    // typed view of a component column in a segment, indices are relative to the segment
+    template <typename T>
+    class component_column
+    {
+    private:
+        column_ref_t column_;
+
+    public:
+        explicit component_column(column_ref_t const& column) noexcept
+            : column_(column) {}
+
+        uint32_t get_lane_width() const noexcept
+        {
+            return column_.lane_width;
+        }
+
+        // plain columns are arrays of T
+        T* data() const noexcept
+        {
+            assert(column_.lane_width == 1);
+            return reinterpret_cast<T*>(column_.data) + column_.first_index;
+        }
+
+        T& operator[](uint32_t index) const noexcept
+        {
+            return data()[index];
+        }
+
+        // a field of the element at index, for both the plain and lane-blocked layout
+        template <size_t FieldIndex>
+        auto& get_field(uint32_t index) const noexcept
+        {
+            using component_traits = static_component_traits<T>;
+            using field_t = typename component_traits::template field_type<FieldIndex>;
+            auto const offset = get_column_field_offset(column_.first_index + index, component_traits::size, column_.lane_width,
+                component_traits::field_offsets[FieldIndex], component_traits::field_sizes[FieldIndex]);
+            return *reinterpret_cast<field_t*>(column_.data + offset);
+        }
+    };
+
+    // run func(task_index) for every task, task 0 on the awaiting thread & the others on the executor
+    // the first exception of the tasks is rethrown when all of them have completed
+    template <typename Func>
+    class parallel_tasks_awaiter
+    {
+    private:
+        async_simple::Executor*     executor_;
+        size_t                      task_count_;
+        Func&                       func_;
+        std::atomic<size_t>         pending_tasks_;
+        std::coroutine_handle<>     continuation_;
+        std::mutex                  exception_mutex_;
+        std::exception_ptr          exception_;
+
+    public:
+        parallel_tasks_awaiter(async_simple::Executor* executor, size_t task_count, Func& func)
+            : executor_(executor)
+            , task_count_(task_count)
+            , func_(func)
+            , pending_tasks_(task_count) {}
+
+        // async_simple's await_transform takes the awaiter by value, it is only moved before it is awaited
+        parallel_tasks_awaiter(parallel_tasks_awaiter&& other) noexcept
+            : executor_(other.executor_)
+            , task_count_(other.task_count_)
+            , func_(other.func_)
+            , pending_tasks_(other.task_count_) {}
+
+        bool await_ready()
+        {
+            if(task_count_ > 1 && executor_)
+            {
+                return false;
+            }
+
+            for(size_t task_index = 0; task_index < task_count_; ++task_index)
+            {
+                run_task(task_index);
+            }
+            return true;
+        }
+
+        bool await_suspend(std::coroutine_handle<> continuation)
+        {
+            continuation_ = continuation;
+            for(size_t task_index = 1; task_index < task_count_; ++task_index)
+            {
+                if(!executor_->schedule([this, task_index]() { run_task(task_index); complete_task(); }))
+                {
+                    run_task(task_index);
+                    complete_task();
+                }
+            }
+            run_task(0);
+            return pending_tasks_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+
+        void await_resume()
+        {
+            if(exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+        }
+
+    private:
+        void run_task(size_t task_index) noexcept
+        {
+            try
+            {
+                func_(task_index);
+            }
+            catch(...)
+            {
+                std::lock_guard lock{ exception_mutex_ };
+                if(!exception_)
+                {
+                    exception_ = std::current_exception();
+                }
+            }
+        }
+
+        void complete_task()
+        {
+            if(pending_tasks_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                continuation_.resume();
+            }
+        }
+    };
+
+    // kernel(element_count, component_column<Args>...) is called for every segment of the matched chunks
+    template <typename ... Args, typename Kernel> requires atleast_one_component_types<Args...>
+    Lazy<error_code> parallel_for_each(async_simple::Executor* executor, runtime_type_system* rtt_system,
+        std::span<archetype_chunks_t const> chunks, Kernel kernel, parallel_for_options options = {})
+    {
+        assert(rtt_system);
+        std::array<type_info_t const*, sizeof...(Args)> const component_types{ rtt_system->get_or_create_type_info<Args>()... };
+
+        chunk_task_plan_t plan;
+        auto const result = plan_chunk_tasks(chunks, component_types, options, plan);
+        if(result != error_code::succeed)
+        {
+            co_return result;
+        }
+
+        auto run_task = [&plan, &kernel](size_t task_index)
+            {
+                for(auto loop = plan.task_offsets[task_index]; loop < plan.task_offsets[task_index + 1]; ++loop)
+                {
+                    auto const& segment = plan.segments[loop];
+                    auto const* columns = plan.columns.data() + segment.first_column;
+                    [&]<size_t ... I>(std::index_sequence<I...>)
+                    {
+                        kernel(segment.element_count, component_column<Args>{ columns[I] }...);
+                    }(std::index_sequence_for<Args...>{});
+                }
+            };
+        co_await parallel_tasks_awaiter<decltype(run_task)>{ executor, plan.get_task_count(), run_task };
+        co_return error_code::succeed;
+    }
+}
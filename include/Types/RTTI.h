@@ -1,15 +1,13 @@
 #pragma once
 
 #include "Meta.h"
+#include "Types/StaticArchetype.hpp"
 #include "Utils/StaticFor.hpp"
 #include "Traits/TypeInfoTraits.hpp"
-#include "async_simple/coro/Lazy.h"
+#include "Task/Lazy.h"
 
 namespace punk
 {
-    template <typename T>
-    using Lazy = async_simple::coro::Lazy<T>;
-
     // runtime type system manages all runtime information about types, components, component groups & archetypes
     class runtime_type_system
     {
@@ -40,6 +38,7 @@ namespace punk
         virtual type_info_t const* get_type_info(uint32_t type_name_hash) const = 0;
 
         // register a type info object created from meta interface
+        // returns the registered one if the type exists, or nullptr if the layout differs from the registered one
         virtual type_info_t const* register_type_info(type_info_t* type_info) = 0;
 
         // generic get_or_create_type_info
@@ -48,10 +47,9 @@ namespace punk
         {
             using type_info_traits_t = type_info_traits<T>;
             auto const type_name = type_info_traits_t::get_type_name();
-            auto const type_name_hash = hash_memory(type_name.c_str(), type_name.length());
 
-            // query exist type info
-            auto* type_info = get_type_info(type_name_hash);
+            // query exist type info, by name in case of name hash collisions
+            auto* type_info = get_type_info(type_name.c_str());
             if (type_info)
             {
                 return type_info;
@@ -67,7 +65,9 @@ namespace punk
                 .vtable = type_info_traits_t::get_vtable(),
                 .field_count = type_info_traits_t::get_field_count(),
                 .component_tag = type_info_traits_t::get_component_tag(),
-                .component_group = type_info_traits<component_group>::get_hash()
+                .component_group = type_info_traits<component_group>::get_hash(),
+                .arithmetic = type_info_traits_t::is_arithmetic(),
+                .lane_blocked = type_info_traits_t::is_lane_blocked()
             };
             type_info_ptr new_type_info { create_type_info(create_info) };
 
@@ -115,10 +115,9 @@ namespace punk
         {
             using type_info_traits_t = type_info_traits<T>;
             auto const type_name = type_info_traits_t::get_type_name();
-            auto const type_name_hash = hash_memory(type_name.c_str(), type_name.length());
 
-            // query exist type info
-            auto* type_info = co_await async_get_type_info(type_name_hash);
+            // query exist type info, by name in case of name hash collisions
+            auto* type_info = co_await async_get_type_info(type_name.c_str());
             if (type_info)
             {
                 co_return type_info;
@@ -134,7 +133,9 @@ namespace punk
                 .vtable = type_info_traits_t::get_vtable(),
                 .field_count = type_info_traits_t::get_field_count(),
                 .component_tag = type_info_traits_t::get_component_tag(),
-                .component_group = type_info_traits<component_group>::get_hash()
+                .component_group = type_info_traits<component_group>::get_hash(),
+                .arithmetic = type_info_traits_t::is_arithmetic(),
+                .lane_blocked = type_info_traits_t::is_lane_blocked()
             };
             type_info_ptr new_type_info { create_type_info(create_info) };
 
@@ -206,7 +207,8 @@ namespace punk
         static runtime_archetype_system* create_instance(runtime_type_system* rtt_system);
 
     public:
-        virtual archetype_ptr get_archetype(uint32_t hash) = 0;
+        // any live archetype of the 64-bit hash
+        virtual archetype_ptr get_archetype(uint64_t hash) = 0;
 
         // runtime version of interfaces
         archetype_ptr get_or_create_archetype(type_info_t const** component_types, size_t component_count);
@@ -223,17 +225,24 @@ namespace punk
             constexpr size_t count = sizeof...(Args);
             std::array<type_info_t const*, count> type_infos = { runtime_type_system_->get_or_create_type_info<Args>() ... };
 
-            // sort types by hash
-            std::stable_sort(type_infos.begin(), type_infos.end(),
-                [](auto const* lhs, auto const* rhs)
-                {
-                    return get_type_hash(lhs) < get_type_hash(rhs);
-                });
-            return get_or_create_archetype_impl(type_infos.data(), count);
+            // a type fails to register when a type of the same name has another layout
+            if(std::ranges::find(type_infos, nullptr) != type_infos.end())
+            {
+                return nullptr;
+            }
+
+            // sort types by hash, the same order as the runtime interface
+            std::stable_sort(type_infos.begin(), type_infos.end(), type_info_less);
+            auto archetype = get_or_create_archetype_impl(type_infos.data(), count);
+
+            // the compile-time layout must agree with the runtime one
+            assert(!archetype || static_archetype_layout<Args...>::verify(archetype.get(),
+                { runtime_type_system_->get_or_create_type_info<Args>()... }));
+            return archetype;
         }
 
         template <typename ... Args> requires atleast_one_component_types<Args...>
-        auto archetype_include_components(archetype_ptr const& archetype) -> std::pair<archetype_ptr, std::array<size_t, sizeof...(Args)>>
+        auto archetype_include_components(archetype_ptr const& archetype) -> std::pair<archetype_ptr, std::array<uint32_t, sizeof...(Args)>>
         {
             assert(runtime_type_system_);
             constexpr size_t component_count = sizeof...(Args);
@@ -241,11 +250,11 @@ namespace punk
             // prepare component types
             std::array<type_info_t const*, component_count> component_types
             {
-                (runtime_type_system_->get_or_create_type_info<Args>(), ...)
+                runtime_type_system_->get_or_create_type_info<Args>()...
             };
 
             // prepare order
-            std::array<size_t, component_count> orders{};
+            std::array<uint32_t, component_count> orders{};
 
             // forward to runtime interface
             auto result_archetype = archetype_include_components(archetype, component_count, component_types.data(), orders.data());
@@ -261,7 +270,7 @@ namespace punk
             constexpr size_t component_count = sizeof...(Args);
             std::array<type_info_t const*, component_count> component_types
             {
-                (runtime_type_system_->get_or_create_type_info<Args>(), ...)
+                runtime_type_system_->get_or_create_type_info<Args>()...
             };
             return archetype_exclude_components(archetype, component_types.data(), component_count);
         }
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Types/RTTI.h"
+#include "Types/ErrorCode.hpp"
+#include <span>
+
+// binary snapshot of archetype chunks
+//   header | chunk records | type table
+// a chunk record holds the columns of one component group, each column is the raw bytes of the chunk column,
+// the type table describes the layout of every saved type, so that columns of a changed layout can be converted on load
+namespace punk
+{
+    class snapshot_writer
+    {
+    public:
+        snapshot_writer() = default;
+        virtual ~snapshot_writer() = default;
+        snapshot_writer(snapshot_writer const&) = delete;
+        snapshot_writer& operator=(snapshot_writer const&) = delete;
+        snapshot_writer(snapshot_writer&&) = delete;
+        snapshot_writer& operator=(snapshot_writer&&) = delete;
+
+        // factory, capacity_hint is the bytes reserved up front for each snapshot, e.g. chunk count * chunk size,
+        // the buffer grows geometrically past it
+        static snapshot_writer* create_instance(size_t capacity_hint = 0);
+
+    public:
+        // write the columns of the component group in chunk, components must be trivially copyable
+        virtual error_code write_chunk(archetype_t const* archetype, uint32_t group_index, chunk_t const* chunk) = 0;
+
+        // append the type table, the writer is reset for the next snapshot
+        virtual std::vector<uint8_t> finish() = 0;
+    };
+
+    class snapshot_reader
+    {
+    public:
+        snapshot_reader() = default;
+        virtual ~snapshot_reader() = default;
+        snapshot_reader(snapshot_reader const&) = delete;
+        snapshot_reader& operator=(snapshot_reader const&) = delete;
+        snapshot_reader(snapshot_reader&&) = delete;
+        snapshot_reader& operator=(snapshot_reader&&) = delete;
+
+        // factory, data must outlive the reader
+        static snapshot_reader* create_instance(std::span<uint8_t const> data);
+
+    public:
+        // validate the header and parse the type table & chunk records
+        virtual error_code open() = 0;
+
+        virtual size_t get_chunk_count() const = 0;
+        virtual uint32_t get_chunk_group_index(size_t chunk_index) const = 0;
+        virtual uint32_t get_chunk_element_count(size_t chunk_index) const = 0;
+
+        // the archetype of the saved chunk in the current type system, nullptr if any of its component types is unknown
+        virtual archetype_ptr resolve_archetype(size_t chunk_index, runtime_archetype_system* archetype_system, runtime_type_system* type_system) const = 0;
+
+        // restore the saved chunk into chunk of the component group,
+        // columns of the same layout are copied as a whole, the others are converted field by field
+        virtual error_code read_chunk(size_t chunk_index, archetype_t const* archetype, uint32_t group_index, chunk_t* chunk) const = 0;
+    };
+}
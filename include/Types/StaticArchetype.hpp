@@ -0,0 +1,224 @@
+#pragma once
+
+#include "Types/Meta.h"
+#include "Traits/TypeInfoTraits.hpp"
+#include "Utils/Hash.hpp"
+#include "Utils/Simd.hpp"
+#include <span>
+
+// chunk layout rules, shared by the runtime archetype system and the compile-time layouts so the two always agree
+namespace punk
+{
+    // memory size of a chunk, and the size of the chunk header before the component columns
+    inline constexpr uint32_t chunk_memory_size = 16 * 1024;
+    inline constexpr uint32_t chunk_header_size = 8;
+
+    struct column_layout_desc
+    {
+        uint32_t    size;
+        uint32_t    alignment;
+        uint32_t    lane_width;     // 1 for plain array layout
+    };
+
+    // lane-blocked columns hold whole blocks, so one block of each column has to fit in the chunk side by side,
+    // the same alignment rule as calculate_group_layout
+    constexpr bool is_group_block_fit(std::span<column_layout_desc const> columns) noexcept
+    {
+        constexpr uint32_t data_block_size = chunk_memory_size - chunk_header_size;
+        uint64_t size = chunk_header_size;
+        for(auto const& column : columns)
+        {
+            auto const alignment = column.lane_width > 1 ? (std::max)(column.alignment, simd_width) : column.alignment;
+            size = align_up(size, uint64_t{ alignment }) + uint64_t{ column.size } * column.lane_width;
+        }
+        return size < data_block_size;
+    }
+
+    // the components too wide for a block of lane_width elements fall back to the plain layout
+    constexpr bool is_lane_block_fit(uint32_t size, uint32_t alignment, uint32_t lane_width) noexcept
+    {
+        column_layout_desc const column{ size, alignment, lane_width };
+        return is_group_block_fit(std::span{ &column, 1 });
+    }
+
+    // search the capacity of a component group in one chunk and the offsets of its columns,
+    // lane-blocked groups only hold whole blocks, so the capacity steps by the lane width
+    constexpr uint32_t calculate_group_layout(std::span<column_layout_desc const> columns, std::span<uint32_t> offsets) noexcept
+    {
+        assert(columns.size() == offsets.size());
+
+        uint32_t all_column_size = 0;
+        uint32_t lane_width = 1;
+        for(auto const& column : columns)
+        {
+            all_column_size += column.size;
+            lane_width = (std::max)(lane_width, column.lane_width);
+        }
+
+        // lane-blocked columns are aligned to the vector register width
+        auto const calculate_chunk_size = [&](uint32_t capacity)
+            {
+                uint32_t size = chunk_header_size;
+                for(size_t loop = 0; loop < columns.size(); ++loop)
+                {
+                    auto const& column = columns[loop];
+                    auto const alignment = column.lane_width > 1 ? (std::max)(column.alignment, simd_width) : column.alignment;
+                    offsets[loop] = align_up(size, alignment);
+                    size = offsets[loop] + column.size * capacity;
+                }
+                return size;
+            };
+
+        // start from (data_block_size / all_column_size + 1) and step down until the columns fit
+        constexpr uint32_t data_block_size = chunk_memory_size - chunk_header_size;
+        uint32_t capacity = align_down(data_block_size / all_column_size, lane_width) + lane_width;
+        uint32_t chunk_size;
+        do
+        {
+            capacity -= lane_width;
+            chunk_size = calculate_chunk_size(capacity);
+        } while(capacity > lane_width && data_block_size <= chunk_size);
+        assert(capacity > 0);
+        return capacity;
+    }
+
+    // offset in the column of a field of the element at index, for both the plain and lane-blocked layout
+    constexpr size_t get_column_field_offset(uint32_t index, uint32_t size, uint32_t lane_width, uint32_t field_offset, uint32_t field_size) noexcept
+    {
+        if(lane_width <= 1)
+        {
+            return size_t{ index } * size + field_offset;
+        }
+
+        auto const block = index / lane_width;
+        auto const lane = index % lane_width;
+        return size_t{ block } * lane_width * size + size_t{ field_offset } * lane_width + size_t{ lane } * field_size;
+    }
+
+    struct static_component_layout
+    {
+        uint32_t    offset_in_chunk;
+        uint32_t    capacity_in_chunk;
+        uint32_t    lane_width;
+    };
+
+    // check the compile-time layout of a component against the runtime archetype
+    bool verify_component_layout(archetype_t const* archetype, type_info_t const* component_type,
+        static_component_layout const& layout, std::span<uint32_t const> field_offsets);
+}
+
+// compile-time layouts of statically known component sets
+namespace punk
+{
+    template <typename T>
+    struct static_component_traits
+    {
+        using traits = type_info_traits<T>;
+        static constexpr uint32_t size = traits::get_size();
+        static constexpr uint32_t alignment = traits::get_alignment();
+        static constexpr uint32_t field_count = traits::get_field_count();
+        static_assert(size > 0, "component types must be complete and not empty.");
+
+        template <size_t I>
+        using field_type = decltype(traits::template get_field_type<I>());
+
+        // the same rule as is_component_lane_blockable, opted in & all fields are arithmetic
+        static constexpr bool lane_blockable = []<size_t ... I>(std::index_sequence<I...>)
+            {
+                return traits::is_lane_blocked() && sizeof...(I) > 0 && (type_info_traits<field_type<I>>::is_arithmetic() && ...);
+            }(std::make_index_sequence<field_count>{});
+
+        static constexpr std::array<uint32_t, field_count> field_sizes = []<size_t ... I>(std::index_sequence<I...>)
+            {
+                return std::array<uint32_t, field_count>{ type_info_traits<field_type<I>>::get_size()... };
+            }(std::make_index_sequence<field_count>{});
+
+        // aggregates lay out their fields in declaration order at the next aligned offset
+        static constexpr std::array<uint32_t, field_count> field_offsets = []<size_t ... I>(std::index_sequence<I...>)
+            {
+                std::array<uint32_t, field_count> result{};
+                uint32_t offset = 0;
+                ((result[I] = align_up(offset, type_info_traits<field_type<I>>::get_alignment()), offset = result[I] + field_sizes[I]), ...);
+                return result;
+            }(std::make_index_sequence<field_count>{});
+
+        // the narrowest field decides the lane width, 0 when not lane-blockable
+        static constexpr uint32_t min_field_size = []
+            {
+                return lane_blockable ? std::ranges::min(field_sizes) : 0u;
+            }();
+    };
+
+    template <typename ... Args>
+    struct static_archetype_layout
+    {
+        static_assert(sizeof...(Args) > 0);
+
+        // the same selection as the runtime archetype system
+        static constexpr uint32_t lane_width = []
+            {
+                uint32_t min_field_size = 0;
+                for(auto const field_size : { static_component_traits<Args>::min_field_size... })
+                {
+                    if(field_size != 0)
+                    {
+                        min_field_size = min_field_size == 0 ? field_size : (std::min)(min_field_size, field_size);
+                    }
+                }
+                return select_simd_lane_width(min_field_size);
+            }();
+
+        // every component is a group of its own
+        template <typename T> requires (std::is_same_v<T, Args> || ...)
+        static constexpr static_component_layout get_component_layout() noexcept
+        {
+            using component_traits = static_component_traits<T>;
+            constexpr uint32_t component_lane_width = component_traits::lane_blockable &&
+                is_lane_block_fit(component_traits::size, component_traits::alignment, lane_width) ? lane_width : 1;
+            constexpr column_layout_desc column{ component_traits::size, component_traits::alignment, component_lane_width };
+            std::array<uint32_t, 1> offsets{};
+            auto const capacity = calculate_group_layout(std::span{ &column, 1 }, offsets);
+            return { offsets[0], capacity, component_lane_width };
+        }
+
+        template <typename T>
+        static constexpr static_component_layout component_layout = get_component_layout<T>();
+
+        // plain columns are arrays of T
+        template <typename T> requires (component_layout<T>.lane_width == 1)
+        static T* get_column(chunk_t* chunk) noexcept
+        {
+            return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(chunk) + component_layout<T>.offset_in_chunk);
+        }
+
+        // address of a field of the element at index, in fixed pointer arithmetic for both layouts
+        template <typename T, size_t FieldIndex>
+        static auto get_field(chunk_t* chunk, uint32_t index) noexcept
+        {
+            using component_traits = static_component_traits<T>;
+            using field_t = typename component_traits::template field_type<FieldIndex>;
+            constexpr auto layout = component_layout<T>;
+            constexpr uint32_t field_offset = component_traits::field_offsets[FieldIndex];
+            constexpr uint32_t field_size = component_traits::field_sizes[FieldIndex];
+
+            auto* column = reinterpret_cast<uint8_t*>(chunk) + layout.offset_in_chunk;
+            return reinterpret_cast<field_t*>(column +
+                get_column_field_offset(index, component_traits::size, layout.lane_width, field_offset, field_size));
+        }
+
+        // the lane_width values of a field in one block of a lane-blocked column
+        template <typename T, size_t FieldIndex> requires (component_layout<T>.lane_width > 1)
+        static auto get_field_block(chunk_t* chunk, uint32_t block_index) noexcept
+        {
+            return get_field<T, FieldIndex>(chunk, block_index * component_layout<T>.lane_width);
+        }
+
+        // type_infos are in the order of Args
+        static bool verify(archetype_t const* archetype, std::array<type_info_t const*, sizeof...(Args)> const& type_infos)
+        {
+            size_t index = 0;
+            return (verify_component_layout(archetype, type_infos[index++], component_layout<Args>,
+                static_component_traits<Args>::field_offsets) && ...);
+        }
+    };
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "Types/RTTI.h"
+#include "async_simple/Executor.h"
+#include <chrono>
+
+// systems declare the components they read & write,
+// the scheduler orders conflicting systems by the order they are added, and runs the others concurrently
+// a frame may be given a time budget, deferrable systems only run in the time left after the others,
+// and are deferred to a later frame or cut into time slices when the frame is behind
+namespace punk
+{
+    using frame_clock = std::chrono::steady_clock;
+
+    enum class budget_class : uint8_t
+    {
+        critical,       // runs every frame, launched before the normal systems when both are ready
+        normal,         // runs every frame
+        deferrable,     // defragmentation, ai planning, analytics... runs after the others if the frame is ahead of budget
+    };
+
+    struct system_schedule_t
+    {
+        budget_class                budget = budget_class::normal;
+        int32_t                     priority = 0;               // higher launches first within the budget class
+        uint32_t                    max_deferred_frames = 0;    // deferrable only, 0 to defer without bound,
+                                                                // otherwise it runs for at least min_time_slice once deferred as many frames
+        std::chrono::microseconds   min_time_slice{ 500 };
+    };
+
+    // time budget of a system in one frame, a deferrable system should check expired() and resume its work next frame
+    struct frame_budget_t
+    {
+        frame_clock::time_point     frame_start;
+        frame_clock::time_point     deadline = frame_clock::time_point::max();      // of the whole frame
+        frame_clock::time_point     slice_end = frame_clock::time_point::max();     // of this system
+
+        bool expired() const noexcept
+        {
+            return frame_clock::now() >= slice_end;
+        }
+
+        frame_clock::duration remaining() const noexcept
+        {
+            auto const now = frame_clock::now();
+            return slice_end > now ? slice_end - now : frame_clock::duration::zero();
+        }
+    };
+
+    struct frame_stats_t
+    {
+        frame_clock::duration       frame_time{};
+        frame_clock::duration       mandatory_time{};           // until the critical & normal systems completed
+        uint32_t                    deferrable_run_count = 0;
+        uint32_t                    deferred_count = 0;         // deferrable systems skipped in the frame
+        bool                        deadline_missed = false;
+    };
+
+    // type lists of the component access
+    template <typename ... Args>
+    struct read_components {};
+
+    template <typename ... Args>
+    struct write_components {};
+
+    // resolved component access of a system
+    struct system_access_t
+    {
+        std::vector<type_info_t const*> reads;
+        std::vector<type_info_t const*> writes;
+    };
+
+    // sort & unique both sets, a written type is not listed as read
+    void normalize_system_access(system_access_t& access);
+
+    // two systems conflict if any type written by one of them is accessed by the other, access must be normalized
+    bool is_system_access_conflict(system_access_t const& lhs, system_access_t const& rhs);
+
+    class system_base
+    {
+    public:
+        system_base() = default;
+        virtual ~system_base() = default;
+        system_base(system_base const&) = delete;
+        system_base& operator=(system_base const&) = delete;
+        system_base(system_base&&) = delete;
+        system_base& operator=(system_base&&) = delete;
+
+    public:
+        virtual std::string_view get_name() const = 0;
+
+        // resolve the component access, called once when the system is added to a scheduler
+        virtual system_access_t get_access(runtime_type_system* rtt_system) const = 0;
+
+        // read once when the system is added to a scheduler
+        virtual system_schedule_t get_schedule() const
+        {
+            return {};
+        }
+
+        // the work of one frame, budget stays valid until the returned task completes
+        virtual Lazy<void> update(frame_budget_t const& budget) = 0;
+    };
+
+    template <typename Reads, typename Writes, typename Func>
+    class function_system;
+
+    // system of a callable, which returns either void or Lazy<void>, and optionally takes the frame_budget_t const&
+    template <typename ... Reads, typename ... Writes, typename Func>
+    class function_system<read_components<Reads...>, write_components<Writes...>, Func> final : public system_base
+    {
+    private:
+        std::string         name_;
+        Func                func_;
+        system_schedule_t   schedule_;
+
+    public:
+        template <typename F>
+        function_system(std::string_view name, F&& func, system_schedule_t const& schedule = {})
+            : name_(name)
+            , func_(std::forward<F>(func))
+            , schedule_(schedule)
+        {}
+
+        virtual std::string_view get_name() const override
+        {
+            return name_;
+        }
+
+        virtual system_access_t get_access(runtime_type_system* rtt_system) const override
+        {
+            assert(rtt_system);
+            return system_access_t
+            {
+                .reads = { rtt_system->get_or_create_type_info<Reads>()... },
+                .writes = { rtt_system->get_or_create_type_info<Writes>()... },
+            };
+        }
+
+        virtual system_schedule_t get_schedule() const override
+        {
+            return schedule_;
+        }
+
+        virtual Lazy<void> update(frame_budget_t const& budget) override
+        {
+            if constexpr(std::is_invocable_v<Func&, frame_budget_t const&>)
+            {
+                if constexpr(std::is_same_v<std::invoke_result_t<Func&, frame_budget_t const&>, Lazy<void>>)
+                {
+                    co_await func_(budget);
+                }
+                else
+                {
+                    func_(budget);
+                }
+            }
+            else if constexpr(std::is_same_v<std::invoke_result_t<Func&>, Lazy<void>>)
+            {
+                co_await func_();
+            }
+            else
+            {
+                func_();
+            }
+            co_return;
+        }
+    };
+
+    template <typename Reads, typename Writes = write_components<>, typename Func>
+    std::unique_ptr<system_base> make_system(std::string_view name, Func&& func, system_schedule_t const& schedule = {})
+    {
+        return std::make_unique<function_system<Reads, Writes, std::decay_t<Func>>>(name, std::forward<Func>(func), schedule);
+    }
+
+    class system_scheduler
+    {
+    protected:
+        system_scheduler(runtime_type_system* rtt_system, async_simple::Executor* executor)
+            : runtime_type_system_(rtt_system)
+            , executor_(executor) {}
+
+    public:
+        system_scheduler(system_scheduler const&) = delete;
+        system_scheduler& operator=(system_scheduler const&) = delete;
+        system_scheduler(system_scheduler&&) = delete;
+        system_scheduler& operator=(system_scheduler&&) = delete;
+        virtual ~system_scheduler() = default;
+
+        // factory, systems run on the executor
+        static system_scheduler* create_instance(runtime_type_system* rtt_system, async_simple::Executor* executor);
+
+    public:
+        // the scheduler owns the added systems, systems must not be added or removed while a frame is running
+        virtual system_base* add_system(std::unique_ptr<system_base> system) = 0;
+        virtual bool remove_system(system_base* system) = 0;
+        virtual size_t get_system_count() const = 0;
+
+        // the systems that run before the given one in a frame
+        virtual std::vector<system_base*> get_dependencies(system_base const* system) = 0;
+
+        // run the critical & normal systems once, then the deferrable ones that fit in the rest of the budget,
+        // the dependency graph is only rebuilt when the systems changed
+        virtual Lazy<void> run_frame(frame_clock::duration budget) = 0;
+
+        virtual frame_stats_t get_last_frame_stats() const = 0;
+
+    public: // generic version of interfaces
+        template <typename Reads, typename Writes = write_components<>, typename Func>
+        system_base* add_system(std::string_view name, Func&& func, system_schedule_t const& schedule = {})
+        {
+            return add_system(make_system<Reads, Writes>(name, std::forward<Func>(func), schedule));
+        }
+
+        // a frame without a budget, every system runs
+        Lazy<void> run_frame()
+        {
+            return run_frame(frame_clock::duration::max());
+        }
+
+    protected:
+        runtime_type_system*        runtime_type_system_;
+        async_simple::Executor*     executor_;
+    };
+}
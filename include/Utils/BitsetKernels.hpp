@@ -0,0 +1,300 @@
+#pragma once
+
+#include "Utils/Simd.hpp"
+
+// bulk kernels over arrays of 64-bit blocks, shared by the bitsets
+// the widest kernel set supported by the running cpu is selected once by get_bitset_kernels()
+namespace punk
+{
+    enum class bitset_binary_op
+    {
+        op_and,
+        op_or,
+        op_xor,
+        op_and_not,
+    };
+
+    struct bitset_kernels
+    {
+        void(*and_blocks)(uint64_t* dst, uint64_t const* src, size_t count) noexcept;
+        void(*or_blocks)(uint64_t* dst, uint64_t const* src, size_t count) noexcept;
+        void(*xor_blocks)(uint64_t* dst, uint64_t const* src, size_t count) noexcept;
+        void(*and_not_blocks)(uint64_t* dst, uint64_t const* src, size_t count) noexcept;
+        size_t(*popcount_blocks)(uint64_t const* blocks, size_t count) noexcept;
+        // index of the first block that is not zero, count if there is none
+        size_t(*find_nonzero_block)(uint64_t const* blocks, size_t count) noexcept;
+        bool(*all_ones_blocks)(uint64_t const* blocks, size_t count) noexcept;
+    };
+
+    namespace bitset_kernel_detail
+    {
+        template <bitset_binary_op Op>
+        constexpr uint64_t apply(uint64_t lhs, uint64_t rhs) noexcept
+        {
+            if constexpr(Op == bitset_binary_op::op_and) { return lhs & rhs; }
+            else if constexpr(Op == bitset_binary_op::op_or) { return lhs | rhs; }
+            else if constexpr(Op == bitset_binary_op::op_xor) { return lhs ^ rhs; }
+            else { return lhs & ~rhs; }
+        }
+
+        // scalar fallback
+        template <bitset_binary_op Op>
+        inline void binary_blocks_scalar(uint64_t* dst, uint64_t const* src, size_t count) noexcept
+        {
+            for(size_t loop = 0; loop < count; ++loop)
+            {
+                dst[loop] = apply<Op>(dst[loop], src[loop]);
+            }
+        }
+
+        inline size_t popcount_blocks_scalar(uint64_t const* blocks, size_t count) noexcept
+        {
+            size_t result = 0;
+            for(size_t loop = 0; loop < count; ++loop)
+            {
+                result += static_cast<size_t>(std::popcount(blocks[loop]));
+            }
+            return result;
+        }
+
+        inline size_t find_nonzero_block_scalar(uint64_t const* blocks, size_t count) noexcept
+        {
+            size_t loop = 0;
+            while(loop < count && blocks[loop] == 0)
+            {
+                ++loop;
+            }
+            return loop;
+        }
+
+        inline bool all_ones_blocks_scalar(uint64_t const* blocks, size_t count) noexcept
+        {
+            for(size_t loop = 0; loop < count; ++loop)
+            {
+                if(blocks[loop] != ~uint64_t{ 0 })
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+#if defined(PUNK_ARCH_X64)
+        // avx2, 4 blocks per step
+        template <bitset_binary_op Op>
+        PUNK_TARGET_AVX2 inline void binary_blocks_avx2(uint64_t* dst, uint64_t const* src, size_t count) noexcept
+        {
+            size_t loop = 0;
+            for(; loop + 4 <= count; loop += 4)
+            {
+                __m256i const lhs = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + loop));
+                __m256i const rhs = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + loop));
+                __m256i result;
+                if constexpr(Op == bitset_binary_op::op_and) { result = _mm256_and_si256(lhs, rhs); }
+                else if constexpr(Op == bitset_binary_op::op_or) { result = _mm256_or_si256(lhs, rhs); }
+                else if constexpr(Op == bitset_binary_op::op_xor) { result = _mm256_xor_si256(lhs, rhs); }
+                else { result = _mm256_andnot_si256(rhs, lhs); }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + loop), result);
+            }
+            for(; loop < count; ++loop)
+            {
+                dst[loop] = apply<Op>(dst[loop], src[loop]);
+            }
+        }
+
+        // nibble lookup popcount (Mula), the byte counts are summed with sad
+        PUNK_TARGET_AVX2 inline size_t popcount_blocks_avx2(uint64_t const* blocks, size_t count) noexcept
+        {
+            __m256i const lookup = _mm256_setr_epi8(
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            __m256i const low_mask = _mm256_set1_epi8(0x0f);
+            __m256i sum = _mm256_setzero_si256();
+
+            size_t loop = 0;
+            for(; loop + 4 <= count; loop += 4)
+            {
+                __m256i const value = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(blocks + loop));
+                __m256i const low = _mm256_and_si256(value, low_mask);
+                __m256i const high = _mm256_and_si256(_mm256_srli_epi16(value, 4), low_mask);
+                __m256i const bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+                sum = _mm256_add_epi64(sum, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+            }
+
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+            auto result = static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+            for(; loop < count; ++loop)
+            {
+                result += static_cast<size_t>(_mm_popcnt_u64(blocks[loop]));
+            }
+            return result;
+        }
+
+        PUNK_TARGET_AVX2 inline size_t find_nonzero_block_avx2(uint64_t const* blocks, size_t count) noexcept
+        {
+            size_t loop = 0;
+            for(; loop + 4 <= count; loop += 4)
+            {
+                __m256i const value = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(blocks + loop));
+                if(!_mm256_testz_si256(value, value))
+                {
+                    break;
+                }
+            }
+            while(loop < count && blocks[loop] == 0)
+            {
+                ++loop;
+            }
+            return loop;
+        }
+
+        PUNK_TARGET_AVX2 inline bool all_ones_blocks_avx2(uint64_t const* blocks, size_t count) noexcept
+        {
+            __m256i const ones = _mm256_set1_epi64x(-1);
+            size_t loop = 0;
+            for(; loop + 4 <= count; loop += 4)
+            {
+                __m256i const value = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(blocks + loop));
+                if(!_mm256_testc_si256(value, ones))
+                {
+                    return false;
+                }
+            }
+            for(; loop < count; ++loop)
+            {
+                if(blocks[loop] != ~uint64_t{ 0 })
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // gcc 12 reports the self-initialized _mm512_undefined_epi32() inside its own avx512fintrin.h as uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+        // avx-512, 8 blocks per step, the tail is handled with masked loads
+        template <bitset_binary_op Op>
+        PUNK_TARGET_AVX512 inline void binary_blocks_avx512(uint64_t* dst, uint64_t const* src, size_t count) noexcept
+        {
+            for(size_t loop = 0; loop < count; loop += 8)
+            {
+                auto const mask = static_cast<__mmask8>(count - loop >= 8 ? 0xff : (1u << (count - loop)) - 1);
+                __m512i const lhs = _mm512_maskz_loadu_epi64(mask, dst + loop);
+                __m512i const rhs = _mm512_maskz_loadu_epi64(mask, src + loop);
+                __m512i result;
+                if constexpr(Op == bitset_binary_op::op_and) { result = _mm512_and_si512(lhs, rhs); }
+                else if constexpr(Op == bitset_binary_op::op_or) { result = _mm512_or_si512(lhs, rhs); }
+                else if constexpr(Op == bitset_binary_op::op_xor) { result = _mm512_xor_si512(lhs, rhs); }
+                else { result = _mm512_andnot_si512(rhs, lhs); }
+                _mm512_mask_storeu_epi64(dst + loop, mask, result);
+            }
+        }
+
+        PUNK_TARGET_AVX512 inline size_t popcount_blocks_avx512(uint64_t const* blocks, size_t count) noexcept
+        {
+            __m512i const lookup = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+            __m512i const low_mask = _mm512_set1_epi8(0x0f);
+            __m512i sum = _mm512_setzero_si512();
+            for(size_t loop = 0; loop < count; loop += 8)
+            {
+                auto const mask = static_cast<__mmask8>(count - loop >= 8 ? 0xff : (1u << (count - loop)) - 1);
+                __m512i const value = _mm512_maskz_loadu_epi64(mask, blocks + loop);
+                __m512i const low = _mm512_and_si512(value, low_mask);
+                __m512i const high = _mm512_and_si512(_mm512_srli_epi16(value, 4), low_mask);
+                __m512i const bytes = _mm512_add_epi8(_mm512_shuffle_epi8(lookup, low), _mm512_shuffle_epi8(lookup, high));
+                sum = _mm512_add_epi64(sum, _mm512_sad_epu8(bytes, _mm512_setzero_si512()));
+            }
+            return static_cast<size_t>(_mm512_reduce_add_epi64(sum));
+        }
+
+        PUNK_TARGET_AVX512 inline size_t find_nonzero_block_avx512(uint64_t const* blocks, size_t count) noexcept
+        {
+            for(size_t loop = 0; loop < count; loop += 8)
+            {
+                auto const mask = static_cast<__mmask8>(count - loop >= 8 ? 0xff : (1u << (count - loop)) - 1);
+                __m512i const value = _mm512_maskz_loadu_epi64(mask, blocks + loop);
+                auto const nonzero = static_cast<uint32_t>(_mm512_test_epi64_mask(value, value));
+                if(nonzero != 0)
+                {
+                    return loop + static_cast<size_t>(std::countr_zero(nonzero));
+                }
+            }
+            return count;
+        }
+
+        PUNK_TARGET_AVX512 inline bool all_ones_blocks_avx512(uint64_t const* blocks, size_t count) noexcept
+        {
+            __m512i const ones = _mm512_set1_epi64(-1);
+            for(size_t loop = 0; loop < count; loop += 8)
+            {
+                auto const mask = static_cast<__mmask8>(count - loop >= 8 ? 0xff : (1u << (count - loop)) - 1);
+                __m512i const value = _mm512_mask_loadu_epi64(ones, mask, blocks + loop);
+                if(_mm512_cmpneq_epu64_mask(value, ones) != 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+        inline bitset_kernels select_bitset_kernels() noexcept
+        {
+#if defined(PUNK_ARCH_X64)
+            auto const& features = get_cpu_features();
+            if(features.avx512)
+            {
+                return
+                {
+                    .and_blocks = &binary_blocks_avx512<bitset_binary_op::op_and>,
+                    .or_blocks = &binary_blocks_avx512<bitset_binary_op::op_or>,
+                    .xor_blocks = &binary_blocks_avx512<bitset_binary_op::op_xor>,
+                    .and_not_blocks = &binary_blocks_avx512<bitset_binary_op::op_and_not>,
+                    .popcount_blocks = &popcount_blocks_avx512,
+                    .find_nonzero_block = &find_nonzero_block_avx512,
+                    .all_ones_blocks = &all_ones_blocks_avx512,
+                };
+            }
+            if(features.avx2)
+            {
+                return
+                {
+                    .and_blocks = &binary_blocks_avx2<bitset_binary_op::op_and>,
+                    .or_blocks = &binary_blocks_avx2<bitset_binary_op::op_or>,
+                    .xor_blocks = &binary_blocks_avx2<bitset_binary_op::op_xor>,
+                    .and_not_blocks = &binary_blocks_avx2<bitset_binary_op::op_and_not>,
+                    .popcount_blocks = &popcount_blocks_avx2,
+                    .find_nonzero_block = &find_nonzero_block_avx2,
+                    .all_ones_blocks = &all_ones_blocks_avx2,
+                };
+            }
+#endif
+            return
+            {
+                .and_blocks = &binary_blocks_scalar<bitset_binary_op::op_and>,
+                .or_blocks = &binary_blocks_scalar<bitset_binary_op::op_or>,
+                .xor_blocks = &binary_blocks_scalar<bitset_binary_op::op_xor>,
+                .and_not_blocks = &binary_blocks_scalar<bitset_binary_op::op_and_not>,
+                .popcount_blocks = &popcount_blocks_scalar,
+                .find_nonzero_block = &find_nonzero_block_scalar,
+                .all_ones_blocks = &all_ones_blocks_scalar,
+            };
+        }
+    }
+
+    inline bitset_kernels const& get_bitset_kernels() noexcept
+    {
+        static bitset_kernels const kernels = bitset_kernel_detail::select_bitset_kernels();
+        return kernels;
+    }
+}
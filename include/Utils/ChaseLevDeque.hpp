@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Types/Forward.hpp"
+#include <atomic>
+#include <cassert>
+#include <optional>
+
+namespace punk
+{
+    inline constexpr size_t cache_line_size = 64;
+
+    // Chase-Lev work-stealing deque, the owner pushes & pops at the bottom, thieves steal from the top
+    // the ring grows on demand, the retired rings are kept alive until the deque is destroyed since thieves may still read them
+    template <typename T> requires std::is_trivially_copyable_v<T>
+    class chase_lev_deque
+    {
+    private:
+        class ring
+        {
+        private:
+            int64_t                         capacity_;
+            std::unique_ptr<std::atomic<T>[]> items_;
+
+        public:
+            explicit ring(int64_t capacity)
+                : capacity_(capacity)
+                , items_(std::make_unique<std::atomic<T>[]>(static_cast<size_t>(capacity)))
+            {
+                assert(std::has_single_bit(static_cast<uint64_t>(capacity)));
+            }
+
+            int64_t get_capacity() const noexcept
+            {
+                return capacity_;
+            }
+
+            T load(int64_t index) const noexcept
+            {
+                return items_[index & (capacity_ - 1)].load(std::memory_order_relaxed);
+            }
+
+            void store(int64_t index, T value) noexcept
+            {
+                items_[index & (capacity_ - 1)].store(value, std::memory_order_relaxed);
+            }
+        };
+
+        alignas(cache_line_size) std::atomic<int64_t>   top_;
+        alignas(cache_line_size) std::atomic<int64_t>   bottom_;
+        std::atomic<ring*>                              ring_;
+        std::vector<std::unique_ptr<ring>>              rings_;     // owner only, the current ring is the last one
+
+    public:
+        explicit chase_lev_deque(size_t capacity = 256)
+            : top_(0)
+            , bottom_(0)
+        {
+            rings_.push_back(std::make_unique<ring>(static_cast<int64_t>(std::bit_ceil((std::max)(capacity, size_t{ 2 })))));
+            ring_.store(rings_.back().get(), std::memory_order_relaxed);
+        }
+
+        chase_lev_deque(chase_lev_deque const&) = delete;
+        chase_lev_deque& operator=(chase_lev_deque const&) = delete;
+
+        // owner only
+        void push(T value)
+        {
+            auto const bottom = bottom_.load(std::memory_order_relaxed);
+            auto const top = top_.load(std::memory_order_acquire);
+            auto* items = ring_.load(std::memory_order_relaxed);
+            if(bottom - top > items->get_capacity() - 1)
+            {
+                items = grow(items, top, bottom);
+            }
+            items->store(bottom, value);
+            bottom_.store(bottom + 1, std::memory_order_release);
+        }
+
+        // owner only, the last pushed item
+        std::optional<T> pop()
+        {
+            auto const bottom = bottom_.load(std::memory_order_relaxed) - 1;
+            auto* items = ring_.load(std::memory_order_relaxed);
+            bottom_.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto top = top_.load(std::memory_order_relaxed);
+
+            std::optional<T> result;
+            if(top <= bottom)
+            {
+                result = items->load(bottom);
+                if(top == bottom)
+                {
+                    // the last item, race against the thieves
+                    if(!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    {
+                        result.reset();
+                    }
+                    bottom_.store(bottom + 1, std::memory_order_relaxed);
+                }
+            }
+            else
+            {
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+        // any thread, the oldest item, fails spuriously when another thief wins the race
+        std::optional<T> steal()
+        {
+            auto top = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto const bottom = bottom_.load(std::memory_order_acquire);
+            if(top >= bottom)
+            {
+                return std::nullopt;
+            }
+
+            auto const value = ring_.load(std::memory_order_acquire)->load(top);
+            if(!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                return std::nullopt;
+            }
+            return value;
+        }
+
+        // approximate when called by a thief
+        size_t size() const noexcept
+        {
+            auto const bottom = bottom_.load(std::memory_order_relaxed);
+            auto const top = top_.load(std::memory_order_relaxed);
+            return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+        }
+
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+    private:
+        ring* grow(ring* items, int64_t top, int64_t bottom)
+        {
+            auto new_items = std::make_unique<ring>(items->get_capacity() * 2);
+            for(auto index = top; index < bottom; ++index)
+            {
+                new_items->store(index, items->load(index));
+            }
+            rings_.push_back(std::move(new_items));
+            ring_.store(rings_.back().get(), std::memory_order_release);
+            return rings_.back().get();
+        }
+    };
+}
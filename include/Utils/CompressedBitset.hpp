@@ -0,0 +1,844 @@
+#pragma once
+
+#include "Utils/BitsetKernels.hpp"
+#include <algorithm>
+#include <cassert>
+
+// compressed bitset over 32-bit values (roaring layout):
+// the value space is split into 64K-bit buckets by the high 16 bits, each non-empty bucket owns one container
+//   array  - sorted 16-bit values, for at most 4096 values
+//   bitmap - 1024 64-bit blocks, for dense buckets
+//   run    - sorted (start, length - 1) pairs, produced by optimize() for clustered buckets and kept on writes while smaller
+namespace punk
+{
+    namespace compressed_bitset_detail
+    {
+        inline constexpr uint32_t array_max_cardinality = 4096;
+        inline constexpr size_t bitmap_block_count = 65536 / 64;
+
+        // sorted set intersection of 16-bit arrays, returns the count written to out
+        inline size_t intersect_arrays_scalar(uint16_t const* lhs, size_t lhs_count, uint16_t const* rhs, size_t rhs_count, uint16_t* out) noexcept
+        {
+            size_t lhs_index = 0, rhs_index = 0, count = 0;
+            while(lhs_index < lhs_count && rhs_index < rhs_count)
+            {
+                if(lhs[lhs_index] < rhs[rhs_index])
+                {
+                    ++lhs_index;
+                }
+                else if(rhs[rhs_index] < lhs[lhs_index])
+                {
+                    ++rhs_index;
+                }
+                else
+                {
+                    out[count++] = lhs[lhs_index];
+                    ++lhs_index;
+                    ++rhs_index;
+                }
+            }
+            return count;
+        }
+
+#if defined(PUNK_ARCH_X64)
+        // block-wise all-pairs compare of 8 x 8 values, the blocks with the smaller max advance
+        PUNK_TARGET_AVX2 inline size_t intersect_arrays_simd(uint16_t const* lhs, size_t lhs_count, uint16_t const* rhs, size_t rhs_count, uint16_t* out) noexcept
+        {
+            size_t lhs_index = 0, rhs_index = 0, count = 0;
+            while(lhs_index + 8 <= lhs_count && rhs_index + 8 <= rhs_count)
+            {
+                __m128i const lhs_values = _mm_loadu_si128(reinterpret_cast<__m128i const*>(lhs + lhs_index));
+                __m128i rhs_values = _mm_loadu_si128(reinterpret_cast<__m128i const*>(rhs + rhs_index));
+
+                // compare each lhs lane with the 8 rotations of the rhs block
+                __m128i matches = _mm_cmpeq_epi16(lhs_values, rhs_values);
+                for(int rotation = 1; rotation < 8; ++rotation)
+                {
+                    rhs_values = _mm_alignr_epi8(rhs_values, rhs_values, 2);
+                    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(lhs_values, rhs_values));
+                }
+
+                // one bit per 16-bit lane
+                auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(matches, _mm_setzero_si128())));
+                for(; mask != 0; mask &= mask - 1)
+                {
+                    out[count++] = lhs[lhs_index + std::countr_zero(mask)];
+                }
+
+                auto const lhs_max = lhs[lhs_index + 7];
+                auto const rhs_max = rhs[rhs_index + 7];
+                lhs_index += lhs_max <= rhs_max ? 8 : 0;
+                rhs_index += rhs_max <= lhs_max ? 8 : 0;
+            }
+            return count + intersect_arrays_scalar(lhs + lhs_index, lhs_count - lhs_index, rhs + rhs_index, rhs_count - rhs_index, out + count);
+        }
+#endif
+
+        // sorted merge appending to out[0, count), a value equal to the last one written is dropped
+        inline size_t merge_unique(uint16_t const* lhs, size_t lhs_count, uint16_t const* rhs, size_t rhs_count, uint16_t* out, size_t count) noexcept
+        {
+            auto append = [&](uint16_t value)
+                {
+                    if(count == 0 || out[count - 1] != value)
+                    {
+                        out[count++] = value;
+                    }
+                };
+            size_t lhs_index = 0, rhs_index = 0;
+            while(lhs_index < lhs_count && rhs_index < rhs_count)
+            {
+                append(lhs[lhs_index] <= rhs[rhs_index] ? lhs[lhs_index++] : rhs[rhs_index++]);
+            }
+            for(; lhs_index < lhs_count; ++lhs_index)
+            {
+                append(lhs[lhs_index]);
+            }
+            for(; rhs_index < rhs_count; ++rhs_index)
+            {
+                append(rhs[rhs_index]);
+            }
+            return count;
+        }
+
+        // sorted set union of 16-bit arrays, returns the count written to out
+        inline size_t unite_arrays_scalar(uint16_t const* lhs, size_t lhs_count, uint16_t const* rhs, size_t rhs_count, uint16_t* out) noexcept
+        {
+            return merge_unique(lhs, lhs_count, rhs, rhs_count, out, 0);
+        }
+
+#if defined(PUNK_ARCH_X64)
+        // bitonic merge network of two sorted 8 x 16-bit blocks, low gets the 8 smallest values, both sorted
+        PUNK_TARGET_AVX2 inline void merge_sorted_blocks(__m128i lhs, __m128i rhs, __m128i& low, __m128i& high) noexcept
+        {
+            __m128i min = _mm_min_epu16(lhs, rhs);
+            high = _mm_max_epu16(lhs, rhs);
+            for(int rotation = 1; rotation < 8; ++rotation)
+            {
+                min = _mm_alignr_epi8(min, min, 2);
+                auto const next_min = _mm_min_epu16(min, high);
+                high = _mm_max_epu16(min, high);
+                min = next_min;
+            }
+            low = _mm_alignr_epi8(min, min, 2);
+        }
+
+        // writes the lanes of a sorted block that differ from their predecessor, the last lane of previous leads
+        PUNK_TARGET_AVX2 inline size_t store_unique(__m128i previous, __m128i values, uint16_t* out, size_t count) noexcept
+        {
+            __m128i const shifted = _mm_alignr_epi8(values, previous, 14);
+            auto const duplicates = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(values, shifted), _mm_setzero_si128())));
+            alignas(16) uint16_t lanes[8];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), values);
+            for(auto mask = ~duplicates & 0xffu; mask != 0; mask &= mask - 1)
+            {
+                out[count++] = lanes[std::countr_zero(mask)];
+            }
+            return count;
+        }
+
+        // blocks of 8 are merged in the order of their first values, the 8 smallest of the two blocks in flight are final
+        PUNK_TARGET_AVX2 inline size_t unite_arrays_simd(uint16_t const* lhs, size_t lhs_count, uint16_t const* rhs, size_t rhs_count, uint16_t* out) noexcept
+        {
+            if(lhs_count < 8 || rhs_count < 8)
+            {
+                return unite_arrays_scalar(lhs, lhs_count, rhs, rhs_count, out);
+            }
+
+            auto const lhs_end = lhs_count & ~size_t{ 7 };
+            auto const rhs_end = rhs_count & ~size_t{ 7 };
+            __m128i low, high;
+            merge_sorted_blocks(_mm_loadu_si128(reinterpret_cast<__m128i const*>(lhs)), _mm_loadu_si128(reinterpret_cast<__m128i const*>(rhs)), low, high);
+
+            // the arrays hold distinct values, so 0xffff can not lead a block with a successor
+            size_t lhs_index = 8, rhs_index = 8;
+            size_t count = store_unique(_mm_set1_epi16(-1), low, out, 0);
+            __m128i previous = low;
+            while(lhs_index < lhs_end && rhs_index < rhs_end)
+            {
+                __m128i next;
+                if(lhs[lhs_index] <= rhs[rhs_index])
+                {
+                    next = _mm_loadu_si128(reinterpret_cast<__m128i const*>(lhs + lhs_index));
+                    lhs_index += 8;
+                }
+                else
+                {
+                    next = _mm_loadu_si128(reinterpret_cast<__m128i const*>(rhs + rhs_index));
+                    rhs_index += 8;
+                }
+                merge_sorted_blocks(next, high, low, high);
+                count = store_unique(previous, low, out, count);
+                previous = low;
+            }
+
+            // the block in flight & the partial tail of the exhausted array are merged with the rest of the other
+            alignas(16) uint16_t pending[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(pending), high);
+            bool const lhs_exhausted = lhs_index >= lhs_end;
+            auto const* tail = lhs_exhausted ? lhs + lhs_index : rhs + rhs_index;
+            auto const tail_count = lhs_exhausted ? lhs_count - lhs_index : rhs_count - rhs_index;
+            std::inplace_merge(pending, std::copy(tail, tail + tail_count, pending + 8) - tail_count, pending + 8 + tail_count);
+            auto const* rest = lhs_exhausted ? rhs + rhs_index : lhs + lhs_index;
+            auto const rest_count = lhs_exhausted ? rhs_count - rhs_index : lhs_count - lhs_index;
+            return merge_unique(pending, 8 + tail_count, rest, rest_count, out, count);
+        }
+#endif
+
+        using intersect_arrays_t = size_t(*)(uint16_t const*, size_t, uint16_t const*, size_t, uint16_t*) noexcept;
+
+        inline intersect_arrays_t get_intersect_arrays() noexcept
+        {
+#if defined(PUNK_ARCH_X64)
+            static intersect_arrays_t const kernel = get_cpu_features().avx2 ? &intersect_arrays_simd : &intersect_arrays_scalar;
+            return kernel;
+#else
+            return &intersect_arrays_scalar;
+#endif
+        }
+
+        using unite_arrays_t = intersect_arrays_t;
+
+        inline unite_arrays_t get_unite_arrays() noexcept
+        {
+#if defined(PUNK_ARCH_X64)
+            static unite_arrays_t const kernel = get_cpu_features().avx2 ? &unite_arrays_simd : &unite_arrays_scalar;
+            return kernel;
+#else
+            return &unite_arrays_scalar;
+#endif
+        }
+    }
+
+    class compressed_bitset
+    {
+    public:
+        using value_type = uint32_t;
+        using size_type = size_t;
+
+    private:
+        class container
+        {
+        public:
+            enum class container_type : uint8_t
+            {
+                array,
+                bitmap,
+                run,
+            };
+
+        private:
+            container_type          type_ = container_type::array;
+            uint32_t                cardinality_ = 0;
+            std::vector<uint16_t>   values_;    // array values, or run (start, length - 1) pairs
+            std::vector<uint64_t>   bitmap_;
+
+        public:
+            container_type get_type() const noexcept { return type_; }
+            uint32_t cardinality() const noexcept { return cardinality_; }
+            bool empty() const noexcept { return cardinality_ == 0; }
+
+            bool test(uint16_t value) const noexcept
+            {
+                switch(type_)
+                {
+                case container_type::array:
+                    return std::ranges::binary_search(values_, value);
+                case container_type::bitmap:
+                    return (bitmap_[value / 64] >> (value % 64)) & 1;
+                case container_type::run:
+                    return find_run(value) != values_.size();
+                }
+                return false;
+            }
+
+            bool set(uint16_t value)
+            {
+                if(type_ == container_type::run)
+                {
+                    return set_run(value);
+                }
+
+                if(type_ == container_type::array)
+                {
+                    auto const itr = std::ranges::lower_bound(values_, value);
+                    if(itr != values_.end() && *itr == value)
+                    {
+                        return false;
+                    }
+                    if(cardinality_ < compressed_bitset_detail::array_max_cardinality)
+                    {
+                        values_.insert(itr, value);
+                        ++cardinality_;
+                        return true;
+                    }
+                    convert_to_bitmap();
+                }
+
+                auto& block = bitmap_[value / 64];
+                auto const mask = uint64_t{ 1 } << (value % 64);
+                if(block & mask)
+                {
+                    return false;
+                }
+                block |= mask;
+                ++cardinality_;
+                return true;
+            }
+
+            bool reset(uint16_t value)
+            {
+                if(type_ == container_type::run)
+                {
+                    return reset_run(value);
+                }
+
+                if(type_ == container_type::array)
+                {
+                    auto const itr = std::ranges::lower_bound(values_, value);
+                    if(itr == values_.end() || *itr != value)
+                    {
+                        return false;
+                    }
+                    values_.erase(itr);
+                    --cardinality_;
+                    return true;
+                }
+
+                auto& block = bitmap_[value / 64];
+                auto const mask = uint64_t{ 1 } << (value % 64);
+                if(!(block & mask))
+                {
+                    return false;
+                }
+                block &= ~mask;
+                --cardinality_;
+                shrink_bitmap();
+                return true;
+            }
+
+            template <typename F>
+            void for_each(uint32_t high_bits, F& f) const
+            {
+                switch(type_)
+                {
+                case container_type::array:
+                    for(auto const value : values_)
+                    {
+                        f(high_bits | value);
+                    }
+                    break;
+                case container_type::bitmap:
+                    for(size_t block = 0; block < bitmap_.size(); ++block)
+                    {
+                        for(auto bits = bitmap_[block]; bits != 0; bits &= bits - 1)
+                        {
+                            f(high_bits | static_cast<uint32_t>(block * 64 + std::countr_zero(bits)));
+                        }
+                    }
+                    break;
+                case container_type::run:
+                    for(size_t run = 0; run < values_.size(); run += 2)
+                    {
+                        uint32_t const start = values_[run];
+                        uint32_t const end = start + values_[run + 1];
+                        for(auto value = start; value <= end; ++value)
+                        {
+                            f(high_bits | value);
+                        }
+                    }
+                    break;
+                }
+            }
+
+            static container intersect(container const& lhs, container const& rhs)
+            {
+                if(lhs.type_ == container_type::run || rhs.type_ == container_type::run)
+                {
+                    return intersect(lhs.as_non_run(), rhs.as_non_run());
+                }
+
+                container result;
+                if(lhs.type_ == container_type::array && rhs.type_ == container_type::array)
+                {
+                    result.values_.resize((std::min)(lhs.values_.size(), rhs.values_.size()));
+                    auto const count = compressed_bitset_detail::get_intersect_arrays()(
+                        lhs.values_.data(), lhs.values_.size(), rhs.values_.data(), rhs.values_.size(), result.values_.data());
+                    result.values_.resize(count);
+                    result.cardinality_ = static_cast<uint32_t>(count);
+                }
+                else if(lhs.type_ == container_type::array || rhs.type_ == container_type::array)
+                {
+                    auto const& array = lhs.type_ == container_type::array ? lhs : rhs;
+                    auto const& bitmap = lhs.type_ == container_type::array ? rhs : lhs;
+                    for(auto const value : array.values_)
+                    {
+                        if(bitmap.test(value))
+                        {
+                            result.values_.push_back(value);
+                        }
+                    }
+                    result.cardinality_ = static_cast<uint32_t>(result.values_.size());
+                }
+                else
+                {
+                    auto const& kernels = get_bitset_kernels();
+                    result.type_ = container_type::bitmap;
+                    result.bitmap_ = lhs.bitmap_;
+                    kernels.and_blocks(result.bitmap_.data(), rhs.bitmap_.data(), result.bitmap_.size());
+                    result.cardinality_ = static_cast<uint32_t>(kernels.popcount_blocks(result.bitmap_.data(), result.bitmap_.size()));
+                    result.shrink_bitmap();
+                }
+                return result;
+            }
+
+            static container unite(container const& lhs, container const& rhs)
+            {
+                if(lhs.type_ == container_type::run || rhs.type_ == container_type::run)
+                {
+                    return unite(lhs.as_non_run(), rhs.as_non_run());
+                }
+
+                container result;
+                if(lhs.type_ == container_type::array && rhs.type_ == container_type::array)
+                {
+                    result.values_.resize(lhs.values_.size() + rhs.values_.size());
+                    auto const count = compressed_bitset_detail::get_unite_arrays()(
+                        lhs.values_.data(), lhs.values_.size(), rhs.values_.data(), rhs.values_.size(), result.values_.data());
+                    result.values_.resize(count);
+                    result.cardinality_ = static_cast<uint32_t>(count);
+                    if(result.cardinality_ > compressed_bitset_detail::array_max_cardinality)
+                    {
+                        result.convert_to_bitmap();
+                    }
+                }
+                else if(lhs.type_ == container_type::array || rhs.type_ == container_type::array)
+                {
+                    auto const& array = lhs.type_ == container_type::array ? lhs : rhs;
+                    auto const& bitmap = lhs.type_ == container_type::array ? rhs : lhs;
+                    result = bitmap;
+                    for(auto const value : array.values_)
+                    {
+                        result.set(value);
+                    }
+                }
+                else
+                {
+                    auto const& kernels = get_bitset_kernels();
+                    result.type_ = container_type::bitmap;
+                    result.bitmap_ = lhs.bitmap_;
+                    kernels.or_blocks(result.bitmap_.data(), rhs.bitmap_.data(), result.bitmap_.size());
+                    result.cardinality_ = static_cast<uint32_t>(kernels.popcount_blocks(result.bitmap_.data(), result.bitmap_.size()));
+                }
+                return result;
+            }
+
+            // switch to runs when they are the smallest representation
+            void optimize()
+            {
+                if(type_ == container_type::run || empty())
+                {
+                    return;
+                }
+
+                std::vector<uint16_t> runs;
+                int32_t run_start = -1, run_end = -2;
+                auto append_value = [&](uint32_t value)
+                    {
+                        auto const low = static_cast<int32_t>(value & 0xffff);
+                        if(low != run_end + 1)
+                        {
+                            if(run_start >= 0)
+                            {
+                                runs.push_back(static_cast<uint16_t>(run_start));
+                                runs.push_back(static_cast<uint16_t>(run_end - run_start));
+                            }
+                            run_start = low;
+                        }
+                        run_end = low;
+                    };
+                for_each(0, append_value);
+                runs.push_back(static_cast<uint16_t>(run_start));
+                runs.push_back(static_cast<uint16_t>(run_end - run_start));
+
+                if(runs.size() * sizeof(uint16_t) < memory_usage())
+                {
+                    type_ = container_type::run;
+                    values_ = std::move(runs);
+                    values_.shrink_to_fit();
+                    std::vector<uint64_t>{}.swap(bitmap_);
+                }
+            }
+
+            size_t memory_usage() const noexcept
+            {
+                return values_.capacity() * sizeof(uint16_t) + bitmap_.capacity() * sizeof(uint64_t);
+            }
+
+            friend bool operator==(container const& lhs, container const& rhs)
+            {
+                if(lhs.cardinality_ != rhs.cardinality_)
+                {
+                    return false;
+                }
+                if(lhs.type_ == rhs.type_)
+                {
+                    return lhs.values_ == rhs.values_ && lhs.bitmap_ == rhs.bitmap_;
+                }
+                return intersect(lhs, rhs).cardinality_ == lhs.cardinality_;
+            }
+
+        private:
+            // count of the runs starting at or before value
+            size_t upper_run(uint16_t value) const noexcept
+            {
+                size_t first = 0, last = values_.size() / 2;
+                while(first < last)
+                {
+                    auto const middle = (first + last) / 2;
+                    if(values_[middle * 2] <= value)
+                    {
+                        first = middle + 1;
+                    }
+                    else
+                    {
+                        last = middle;
+                    }
+                }
+                return first;
+            }
+
+            // index of the run containing value, values_.size() if there is none
+            size_t find_run(uint16_t value) const noexcept
+            {
+                auto const first = upper_run(value);
+                if(first == 0)
+                {
+                    return values_.size();
+                }
+                auto const run = (first - 1) * 2;
+                return value - values_[run] <= values_[run + 1] ? run : values_.size();
+            }
+
+            // extends or joins the neighbouring runs, a contiguous id range stays a single run
+            bool set_run(uint16_t value)
+            {
+                auto const next = upper_run(value) * 2;
+                auto const previous = next == 0 ? values_.size() : next - 2;
+                if(previous != values_.size() && value - values_[previous] <= values_[previous + 1])
+                {
+                    return false;
+                }
+
+                bool const extends_previous = previous != values_.size() && values_[previous] + values_[previous + 1] + 1 == value;
+                bool const extends_next = next != values_.size() && value + 1 == values_[next];
+                if(extends_previous && extends_next)
+                {
+                    values_[previous + 1] = static_cast<uint16_t>(values_[previous + 1] + values_[next + 1] + 2);
+                    values_.erase(values_.begin() + next, values_.begin() + next + 2);
+                }
+                else if(extends_previous)
+                {
+                    ++values_[previous + 1];
+                }
+                else if(extends_next)
+                {
+                    --values_[next];
+                    ++values_[next + 1];
+                }
+                else
+                {
+                    uint16_t const run[] = { value, 0 };
+                    values_.insert(values_.begin() + next, std::begin(run), std::end(run));
+                }
+                ++cardinality_;
+                shrink_runs();
+                return true;
+            }
+
+            // trims the run holding value, or splits it in two
+            bool reset_run(uint16_t value)
+            {
+                auto const run = find_run(value);
+                if(run == values_.size())
+                {
+                    return false;
+                }
+
+                uint16_t const start = values_[run];
+                uint16_t const end = static_cast<uint16_t>(start + values_[run + 1]);
+                if(start == end)
+                {
+                    values_.erase(values_.begin() + run, values_.begin() + run + 2);
+                }
+                else if(value == start)
+                {
+                    ++values_[run];
+                    --values_[run + 1];
+                }
+                else if(value == end)
+                {
+                    --values_[run + 1];
+                }
+                else
+                {
+                    values_[run + 1] = static_cast<uint16_t>(value - start - 1);
+                    uint16_t const tail[] = { static_cast<uint16_t>(value + 1), static_cast<uint16_t>(end - value - 1) };
+                    values_.insert(values_.begin() + run + 2, std::begin(tail), std::end(tail));
+                }
+                --cardinality_;
+                shrink_runs();
+                return true;
+            }
+
+            // runs that outgrow the array or bitmap of the same values are decompressed
+            void shrink_runs()
+            {
+                auto const non_run_size = cardinality_ <= compressed_bitset_detail::array_max_cardinality ?
+                    cardinality_ * sizeof(uint16_t) : compressed_bitset_detail::bitmap_block_count * sizeof(uint64_t);
+                if(values_.size() * sizeof(uint16_t) <= non_run_size)
+                {
+                    return;
+                }
+                convert_to_bitmap();
+                shrink_bitmap();
+            }
+
+            container as_non_run() const
+            {
+                if(type_ != container_type::run)
+                {
+                    return *this;
+                }
+                container result{ *this };
+                result.convert_to_bitmap();
+                result.shrink_bitmap();
+                return result;
+            }
+
+            void convert_to_bitmap()
+            {
+                std::vector<uint64_t> bitmap(compressed_bitset_detail::bitmap_block_count, 0);
+                auto set_bit = [&](uint32_t value) { bitmap[(value & 0xffff) / 64] |= uint64_t{ 1 } << (value % 64); };
+                for_each(0, set_bit);
+                type_ = container_type::bitmap;
+                bitmap_ = std::move(bitmap);
+                std::vector<uint16_t>{}.swap(values_);
+            }
+
+            // a sparse bitmap goes back to an array
+            void shrink_bitmap()
+            {
+                if(type_ != container_type::bitmap || cardinality_ > compressed_bitset_detail::array_max_cardinality)
+                {
+                    return;
+                }
+
+                std::vector<uint16_t> values;
+                values.reserve(cardinality_);
+                auto append_value = [&](uint32_t value) { values.push_back(static_cast<uint16_t>(value)); };
+                for_each(0, append_value);
+                type_ = container_type::array;
+                values_ = std::move(values);
+                std::vector<uint64_t>{}.swap(bitmap_);
+            }
+        };
+
+        // sorted by key, the high 16 bits of the values
+        std::vector<uint16_t>   keys_;
+        std::vector<container>  containers_;
+
+    public:
+        compressed_bitset() = default;
+
+        compressed_bitset(std::initializer_list<value_type> values)
+        {
+            for(auto const value : values)
+            {
+                set(value);
+            }
+        }
+
+    public: // member access
+        bool test(value_type value) const noexcept
+        {
+            auto const index = find_key(high_bits(value));
+            return index < keys_.size() && keys_[index] == high_bits(value) && containers_[index].test(low_bits(value));
+        }
+
+        size_type count() const noexcept
+        {
+            size_type result = 0;
+            for(auto const& container : containers_)
+            {
+                result += container.cardinality();
+            }
+            return result;
+        }
+
+        bool empty() const noexcept
+        {
+            return containers_.empty();
+        }
+
+        bool any() const noexcept
+        {
+            return !empty();
+        }
+
+        // visit the values in ascending order
+        template <typename F>
+        void for_each(F&& f) const
+        {
+            for(size_t index = 0; index < keys_.size(); ++index)
+            {
+                containers_[index].for_each(uint32_t{ keys_[index] } << 16, f);
+            }
+        }
+
+        size_t memory_usage() const noexcept
+        {
+            size_t result = keys_.capacity() * sizeof(uint16_t) + containers_.capacity() * sizeof(container);
+            for(auto const& container : containers_)
+            {
+                result += container.memory_usage();
+            }
+            return result;
+        }
+
+    public: // modifiers
+        // returns false if the value is already set
+        bool set(value_type value)
+        {
+            auto const key = high_bits(value);
+            auto const index = find_key(key);
+            if(index == keys_.size() || keys_[index] != key)
+            {
+                keys_.insert(keys_.begin() + index, key);
+                containers_.insert(containers_.begin() + index, container{});
+            }
+            return containers_[index].set(low_bits(value));
+        }
+
+        // returns false if the value is not set
+        bool reset(value_type value)
+        {
+            auto const key = high_bits(value);
+            auto const index = find_key(key);
+            if(index == keys_.size() || keys_[index] != key || !containers_[index].reset(low_bits(value)))
+            {
+                return false;
+            }
+            if(containers_[index].empty())
+            {
+                keys_.erase(keys_.begin() + index);
+                containers_.erase(containers_.begin() + index);
+            }
+            return true;
+        }
+
+        void clear() noexcept
+        {
+            keys_.clear();
+            containers_.clear();
+        }
+
+        // convert clustered buckets to run containers
+        void optimize()
+        {
+            for(auto& container : containers_)
+            {
+                container.optimize();
+            }
+        }
+
+        compressed_bitset& operator&=(compressed_bitset const& other)
+        {
+            *this = *this & other;
+            return *this;
+        }
+
+        compressed_bitset& operator|=(compressed_bitset const& other)
+        {
+            *this = *this | other;
+            return *this;
+        }
+
+    public: // friends
+        friend compressed_bitset operator&(compressed_bitset const& lhs, compressed_bitset const& rhs)
+        {
+            compressed_bitset result;
+            size_t lhs_index = 0, rhs_index = 0;
+            while(lhs_index < lhs.keys_.size() && rhs_index < rhs.keys_.size())
+            {
+                auto const lhs_key = lhs.keys_[lhs_index];
+                auto const rhs_key = rhs.keys_[rhs_index];
+                if(lhs_key < rhs_key)
+                {
+                    ++lhs_index;
+                }
+                else if(rhs_key < lhs_key)
+                {
+                    ++rhs_index;
+                }
+                else
+                {
+                    auto intersection = container::intersect(lhs.containers_[lhs_index++], rhs.containers_[rhs_index++]);
+                    if(!intersection.empty())
+                    {
+                        result.keys_.push_back(lhs_key);
+                        result.containers_.push_back(std::move(intersection));
+                    }
+                }
+            }
+            return result;
+        }
+
+        friend compressed_bitset operator|(compressed_bitset const& lhs, compressed_bitset const& rhs)
+        {
+            compressed_bitset result;
+            size_t lhs_index = 0, rhs_index = 0;
+            while(lhs_index < lhs.keys_.size() || rhs_index < rhs.keys_.size())
+            {
+                auto const lhs_key = lhs_index < lhs.keys_.size() ? uint32_t{ lhs.keys_[lhs_index] } : 0x10000u;
+                auto const rhs_key = rhs_index < rhs.keys_.size() ? uint32_t{ rhs.keys_[rhs_index] } : 0x10000u;
+                if(lhs_key < rhs_key)
+                {
+                    result.keys_.push_back(static_cast<uint16_t>(lhs_key));
+                    result.containers_.push_back(lhs.containers_[lhs_index++]);
+                }
+                else if(rhs_key < lhs_key)
+                {
+                    result.keys_.push_back(static_cast<uint16_t>(rhs_key));
+                    result.containers_.push_back(rhs.containers_[rhs_index++]);
+                }
+                else
+                {
+                    result.keys_.push_back(static_cast<uint16_t>(lhs_key));
+                    result.containers_.push_back(container::unite(lhs.containers_[lhs_index++], rhs.containers_[rhs_index++]));
+                }
+            }
+            return result;
+        }
+
+        friend bool operator==(compressed_bitset const& lhs, compressed_bitset const& rhs)
+        {
+            return lhs.keys_ == rhs.keys_ && lhs.containers_ == rhs.containers_;
+        }
+
+    private:
+        static constexpr uint16_t high_bits(value_type value) noexcept
+        {
+            return static_cast<uint16_t>(value >> 16);
+        }
+
+        static constexpr uint16_t low_bits(value_type value) noexcept
+        {
+            return static_cast<uint16_t>(value);
+        }
+
+        size_t find_key(uint16_t key) const noexcept
+        {
+            return static_cast<size_t>(std::ranges::lower_bound(keys_, key) - keys_.begin());
+        }
+    };
+}
@@ -0,0 +1,442 @@
+#pragma once
+
+#include "Types/Forward.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace punk
+{
+    // fixed capacity group of a concurrent hive, the group object holds the occupancy bits and the element storage
+    // the owner (an inserter) allocates without synchronization, any thread erases with atomic bit clears,
+    // erased slots are parked in the pending bits until the hive collects them into the free list
+    template <typename T, size_t Capacity>
+    class concurrent_hive_group
+    {
+    public:
+        using value_type = T;
+        using pointer = std::add_pointer_t<value_type>;
+        using const_pointer = std::add_pointer_t<std::add_const_t<value_type>>;
+        using bits_block_type = uint64_t;
+        static constexpr size_t value_size = sizeof(value_type);
+        static constexpr size_t bits_per_block = std::numeric_limits<bits_block_type>::digits;
+        static constexpr size_t bits_block_count = Capacity / bits_per_block;
+        static constexpr uint32_t invalid_slot_index = (std::numeric_limits<uint32_t>::max)();
+        struct element_storage
+        {
+            alignas(T) std::array<uint8_t, value_size> bytes_;
+        };
+        static_assert(value_size >= sizeof(uint32_t));
+        static_assert(Capacity % bits_per_block == 0 && Capacity <= invalid_slot_index);
+
+    private:
+        std::array<std::atomic<bits_block_type>, bits_block_count>  alive_bits_{};
+        std::array<std::atomic<bits_block_type>, bits_block_count>  pending_free_bits_{};
+        // owner state, only touched by the owning inserter or at collect
+        uint32_t                                                    fresh_index_ = 0;
+        uint32_t                                                    free_head_ = invalid_slot_index;
+        size_t const                                                group_index_;
+        std::array<element_storage, Capacity>                       storage_;
+
+    public:
+        explicit concurrent_hive_group(size_t group_index) noexcept
+            : group_index_(group_index) {}
+
+        ~concurrent_hive_group()
+        {
+            if constexpr(std::negation_v<std::is_trivially_destructible<value_type>>)
+            {
+                for_each([](value_type& value) { value.~value_type(); });
+            }
+        }
+
+        concurrent_hive_group(concurrent_hive_group const&) = delete;
+        concurrent_hive_group& operator=(concurrent_hive_group const&) = delete;
+
+        size_t get_group_index() const noexcept
+        {
+            return group_index_;
+        }
+
+        // owner side
+        bool has_available_space() const noexcept
+        {
+            return free_head_ != invalid_slot_index || fresh_index_ < Capacity;
+        }
+
+        template <typename ... Args>
+        auto construct(Args&& ... args) -> std::pair<pointer, size_t>
+        {
+            assert(has_available_space());
+
+            // recycle the collected slots first, then the never used ones
+            uint32_t index = free_head_;
+            if(index != invalid_slot_index)
+            {
+                free_head_ = *get_ptr_as<uint32_t>(index);
+            }
+            else
+            {
+                index = fresh_index_++;
+            }
+
+            auto* ptr = new (get_ptr(index)) value_type{ std::forward<Args>(args)... };
+
+            // publish, other bits of the word may be cleared by erasers at the same time
+            alive_bits_[index / bits_per_block].fetch_or(bit_mask(index), std::memory_order_release);
+            return { ptr, group_index_ * Capacity + index };
+        }
+
+        // any thread
+        pointer get(size_t index) const noexcept
+        {
+            assert(index < Capacity);
+            if(alive_bits_[index / bits_per_block].load(std::memory_order_acquire) & bit_mask(index))
+            {
+                return const_cast<pointer>(get_ptr_as<value_type>(index));
+            }
+            return nullptr;
+        }
+
+        // any thread, only the winner of the bit clear destroys the element
+        bool destruct(size_t index) noexcept
+        {
+            assert(index < Capacity);
+            auto const mask = bit_mask(index);
+            auto const previous = alive_bits_[index / bits_per_block].fetch_and(~mask, std::memory_order_acq_rel);
+            if(!(previous & mask))
+            {
+                return false;
+            }
+
+            if constexpr(std::negation_v<std::is_trivially_destructible<value_type>>)
+            {
+                get_ptr_as<value_type>(index)->~value_type();
+            }
+            pending_free_bits_[index / bits_per_block].fetch_or(mask, std::memory_order_release);
+            return true;
+        }
+
+        // merge the pending erased slots into the free list, at the sync point only
+        void collect() noexcept
+        {
+            for(size_t block = 0; block < bits_block_count; ++block)
+            {
+                auto bits = pending_free_bits_[block].exchange(0, std::memory_order_acquire);
+                for(; bits != 0; bits &= bits - 1)
+                {
+                    auto const index = static_cast<uint32_t>(block * bits_per_block + std::countr_zero(bits));
+                    *get_ptr_as<uint32_t>(index) = free_head_;
+                    free_head_ = index;
+                }
+            }
+        }
+
+        // no alive element, checked at the sync point only
+        bool empty() const noexcept
+        {
+            return std::ranges::all_of(alive_bits_, [](auto const& bits) { return bits.load(std::memory_order_relaxed) == 0; });
+        }
+
+        template <typename F>
+        void for_each(F&& f)
+        {
+            for(size_t block = 0; block < bits_block_count; ++block)
+            {
+                for(auto bits = alive_bits_[block].load(std::memory_order_acquire); bits != 0; bits &= bits - 1)
+                {
+                    f(*get_ptr_as<value_type>(block * bits_per_block + std::countr_zero(bits)));
+                }
+            }
+        }
+
+    private:
+        static constexpr bits_block_type bit_mask(size_t index) noexcept
+        {
+            return bits_block_type{ 1 } << (index % bits_per_block);
+        }
+
+        uint8_t* get_ptr(size_t index) noexcept
+        {
+            return storage_[index].bytes_.data();
+        }
+
+        template <typename U>
+        U* get_ptr_as(size_t index) noexcept
+        {
+            return reinterpret_cast<U*>(get_ptr(index));
+        }
+
+        template <typename U>
+        U const* get_ptr_as(size_t index) const noexcept
+        {
+            return reinterpret_cast<U const*>(storage_[index].bytes_.data());
+        }
+    };
+
+    // thread-safe hive with stable addresses & global indices:
+    //   insertion goes through an inserter per worker thread, which owns an active group and needs no synchronization,
+    //   erasure is safe from any thread, the erased slots are reused after collect() at the sync point,
+    //   get() is wait-free, two acquire loads in the group directory and one in the occupancy bits
+    // get() racing with the erasure of the same element must be ordered by the caller
+    template <typename T, size_t GroupCapacity = 1024, typename Alloc = std::allocator<T>>
+    class concurrent_hive
+    {
+    public:
+        using hive_group_type = concurrent_hive_group<T, GroupCapacity>;
+        using value_type = T;
+        using pointer = typename hive_group_type::pointer;
+        using const_pointer = typename hive_group_type::const_pointer;
+        using allocator_type = Alloc;
+        static constexpr size_t group_capacity = GroupCapacity;
+
+        // two-level directory of groups indexed by group index, pages are created lock-free on first use
+        static constexpr size_t directory_page_size = 1024;
+        static constexpr size_t directory_page_count = 1024;
+        static constexpr size_t max_group_count = directory_page_size * directory_page_count;
+
+    private:
+        using hive_group_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<hive_group_type>;
+        using directory_page = std::array<std::atomic<hive_group_type*>, directory_page_size>;
+
+        std::array<std::atomic<directory_page*>, directory_page_count> directory_{};
+        std::atomic<size_t>                 group_count_ = 0;   // one past the highest group index ever created
+
+        // the groups not owned by any inserter, handed out when an inserter runs out of space
+        std::mutex                          available_mutex_;
+        std::vector<hive_group_type*>       available_groups_;
+        std::vector<size_t>                 free_group_indices_;
+        std::vector<hive_group_type*>       owned_groups_;
+
+    public:
+        // per-thread insertion front end, must not be shared between threads
+        class inserter
+        {
+        private:
+            concurrent_hive*    hive_;
+            hive_group_type*    active_group_ = nullptr;
+
+        public:
+            explicit inserter(concurrent_hive& hive) noexcept
+                : hive_(&hive) {}
+
+            ~inserter()
+            {
+                retire();
+            }
+
+            inserter(inserter&& other) noexcept
+                : hive_(other.hive_)
+                , active_group_(std::exchange(other.active_group_, nullptr)) {}
+
+            inserter(inserter const&) = delete;
+            inserter& operator=(inserter const&) = delete;
+            inserter& operator=(inserter&&) = delete;
+
+            template <typename ... Args> requires(std::constructible_from<value_type, Args&&...>)
+            auto construct(Args&& ... args) -> std::pair<pointer, size_t>
+            {
+                if(!active_group_ || !active_group_->has_available_space())
+                {
+                    retire();
+                    active_group_ = hive_->acquire_group();
+                }
+                return active_group_->construct(std::forward<Args>(args)...);
+            }
+
+            // give the active group back to the hive
+            void retire()
+            {
+                if(active_group_)
+                {
+                    hive_->release_group(std::exchange(active_group_, nullptr));
+                }
+            }
+        };
+
+    public:
+        concurrent_hive() = default;
+        concurrent_hive(concurrent_hive const&) = delete;
+        concurrent_hive& operator=(concurrent_hive const&) = delete;
+
+        // all the inserters must be retired before the hive is destroyed
+        ~concurrent_hive()
+        {
+            assert(owned_groups_.empty());
+            for(auto& page_ptr : directory_)
+            {
+                auto* page = page_ptr.load(std::memory_order_acquire);
+                if(!page)
+                {
+                    continue;
+                }
+                for(auto& group : *page)
+                {
+                    if(auto* hive_group = group.load(std::memory_order_acquire))
+                    {
+                        destroy_group(hive_group);
+                    }
+                }
+                delete page;
+            }
+        }
+
+        inserter get_inserter() noexcept
+        {
+            return inserter{ *this };
+        }
+
+        // wait-free
+        pointer get(size_t global_index) const noexcept
+        {
+            auto const* hive_group = get_hive_group(global_index / group_capacity);
+            return hive_group ? hive_group->get(global_index % group_capacity) : nullptr;
+        }
+
+        // any thread, returns false if the element is not alive
+        bool destruct(size_t global_index) noexcept
+        {
+            auto* hive_group = get_hive_group(global_index / group_capacity);
+            return hive_group && hive_group->destruct(global_index % group_capacity);
+        }
+
+        // merge the erased slots into the free lists of their groups and release the empty groups,
+        // must be called at the sync point when no thread inserts or erases
+        void collect()
+        {
+            std::lock_guard lock{ available_mutex_ };
+            available_groups_.clear();
+
+            auto const group_count = group_count_.load(std::memory_order_acquire);
+            for(size_t group_index = 0; group_index < group_count; ++group_index)
+            {
+                auto* hive_group = get_hive_group(group_index);
+                if(!hive_group)
+                {
+                    continue;
+                }
+                hive_group->collect();
+
+                // groups owned by inserters stay with them
+                if(std::ranges::find(owned_groups_, hive_group) != owned_groups_.end())
+                {
+                    continue;
+                }
+
+                if(hive_group->empty())
+                {
+                    get_group_slot(group_index).store(nullptr, std::memory_order_release);
+                    destroy_group(hive_group);
+                    free_group_indices_.push_back(group_index);
+                }
+                else if(hive_group->has_available_space())
+                {
+                    available_groups_.push_back(hive_group);
+                }
+            }
+        }
+
+        // visit all the alive elements, at the sync point only
+        template <typename F>
+        void for_each(F&& f)
+        {
+            auto const group_count = group_count_.load(std::memory_order_acquire);
+            for(size_t group_index = 0; group_index < group_count; ++group_index)
+            {
+                if(auto* hive_group = get_hive_group(group_index))
+                {
+                    hive_group->for_each(f);
+                }
+            }
+        }
+
+    private:
+        hive_group_type* get_hive_group(size_t group_index) const noexcept
+        {
+            if(group_index >= max_group_count)
+            {
+                return nullptr;
+            }
+            auto const* page = directory_[group_index / directory_page_size].load(std::memory_order_acquire);
+            return page ? (*page)[group_index % directory_page_size].load(std::memory_order_acquire) : nullptr;
+        }
+
+        std::atomic<hive_group_type*>& get_group_slot(size_t group_index)
+        {
+            auto& page_ptr = directory_[group_index / directory_page_size];
+            auto* page = page_ptr.load(std::memory_order_acquire);
+            if(!page)
+            {
+                auto new_page = std::make_unique<directory_page>();
+                if(page_ptr.compare_exchange_strong(page, new_page.get(), std::memory_order_acq_rel))
+                {
+                    page = new_page.release();
+                }
+            }
+            return (*page)[group_index % directory_page_size];
+        }
+
+        // an available group, or a new one
+        hive_group_type* acquire_group()
+        {
+            std::lock_guard lock{ available_mutex_ };
+            hive_group_type* hive_group = nullptr;
+            if(!available_groups_.empty())
+            {
+                hive_group = available_groups_.back();
+                available_groups_.pop_back();
+            }
+            else
+            {
+                size_t group_index;
+                if(!free_group_indices_.empty())
+                {
+                    group_index = free_group_indices_.back();
+                    free_group_indices_.pop_back();
+                }
+                else
+                {
+                    group_index = group_count_.load(std::memory_order_relaxed);
+                    if(group_index >= max_group_count)
+                    {
+                        throw std::length_error{ "concurrent hive exceeds the max group count." };
+                    }
+                }
+
+                hive_group = create_group(group_index);
+                get_group_slot(group_index).store(hive_group, std::memory_order_release);
+                if(group_index == group_count_.load(std::memory_order_relaxed))
+                {
+                    group_count_.store(group_index + 1, std::memory_order_release);
+                }
+            }
+            owned_groups_.push_back(hive_group);
+            return hive_group;
+        }
+
+        void release_group(hive_group_type* hive_group)
+        {
+            std::lock_guard lock{ available_mutex_ };
+            std::erase(owned_groups_, hive_group);
+            if(hive_group->has_available_space())
+            {
+                available_groups_.push_back(hive_group);
+            }
+        }
+
+        static hive_group_type* create_group(size_t group_index)
+        {
+            auto* ptr = hive_group_allocator{}.allocate(1);
+            return new (ptr) hive_group_type{ group_index };
+        }
+
+        static void destroy_group(hive_group_type* hive_group) noexcept
+        {
+            hive_group->~hive_group_type();
+            hive_group_allocator{}.deallocate(hive_group, 1);
+        }
+    };
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "Types/Forward.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <span>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <filesystem>
+#include <fstream>
+#endif
+
+// logical cores grouped by numa node, and the split of them into per game instance partitions
+namespace punk
+{
+    struct numa_node_info
+    {
+        uint32_t                numa_node = 0;
+        std::vector<uint32_t>   cores = {};     // logical core indices, ascending
+    };
+
+    // a core set on a single numa node whenever the node has a core left for it
+    struct core_partition
+    {
+        uint32_t                numa_node = 0;
+        std::vector<uint32_t>   cores = {};
+    };
+
+#if defined(__linux__)
+    // parses the kernel cpu list format, e.g. "0-3,8-11"
+    inline std::vector<uint32_t> parse_cpu_list(std::string_view list)
+    {
+        std::vector<uint32_t> cores;
+        while(!list.empty())
+        {
+            auto const comma = list.find(',');
+            auto const range = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+            auto const dash = range.find('-');
+            auto const first = static_cast<uint32_t>(std::strtoul(std::string{ range.substr(0, dash) }.c_str(), nullptr, 10));
+            auto const last = dash == std::string_view::npos ? first :
+                static_cast<uint32_t>(std::strtoul(std::string{ range.substr(dash + 1) }.c_str(), nullptr, 10));
+            for(auto core = first; core <= last; ++core)
+            {
+                cores.push_back(core);
+            }
+        }
+        return cores;
+    }
+#endif
+
+    // nodes without cores are skipped, a single node holding all the cores when the os reports no topology
+    inline std::vector<numa_node_info> get_numa_topology()
+    {
+        std::vector<numa_node_info> nodes;
+#if defined(_WIN32)
+        ULONG highest_node = 0;
+        if(GetNumaHighestNodeNumber(&highest_node))
+        {
+            for(ULONG node = 0; node <= highest_node; ++node)
+            {
+                GROUP_AFFINITY affinity{};
+                if(!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity))
+                {
+                    continue;
+                }
+                numa_node_info info{ .numa_node = static_cast<uint32_t>(node) };
+                for(uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+                {
+                    if(affinity.Mask & (KAFFINITY{ 1 } << bit))
+                    {
+                        info.cores.push_back(affinity.Group * static_cast<uint32_t>(sizeof(KAFFINITY) * 8) + bit);
+                    }
+                }
+                if(!info.cores.empty())
+                {
+                    nodes.push_back(std::move(info));
+                }
+            }
+        }
+#elif defined(__linux__)
+        std::error_code error;
+        for(auto const& entry : std::filesystem::directory_iterator{ "/sys/devices/system/node", error })
+        {
+            auto const name = entry.path().filename().string();
+            if(!name.starts_with("node") || name.size() == 4 || !std::ranges::all_of(name.substr(4), [](char c) { return c >= '0' && c <= '9'; }))
+            {
+                continue;
+            }
+
+            std::ifstream file{ entry.path() / "cpulist" };
+            std::string list;
+            if(!std::getline(file, list))
+            {
+                continue;
+            }
+            numa_node_info info{ .numa_node = static_cast<uint32_t>(std::stoul(name.substr(4))), .cores = parse_cpu_list(list) };
+            if(!info.cores.empty())
+            {
+                nodes.push_back(std::move(info));
+            }
+        }
+        std::ranges::sort(nodes, {}, &numa_node_info::numa_node);
+#endif
+        if(nodes.empty())
+        {
+            numa_node_info info{ .numa_node = 0 };
+            auto const core_count = (std::max)(std::thread::hardware_concurrency(), 1u);
+            for(uint32_t core = 0; core < core_count; ++core)
+            {
+                info.cores.push_back(core);
+            }
+            nodes.push_back(std::move(info));
+        }
+        return nodes;
+    }
+
+    // partitions are dealt to the nodes in proportion to their core counts, then the cores of each node are split
+    // evenly among its partitions, so no partition spans two sockets, partitions only share cores when a node
+    // has fewer cores than partitions
+    inline std::vector<core_partition> partition_cores(std::span<numa_node_info const> nodes, uint32_t partition_count)
+    {
+        std::vector<core_partition> partitions;
+        if(nodes.empty() || partition_count == 0)
+        {
+            return partitions;
+        }
+
+        // each partition goes to the node furthest below its share of the cores
+        size_t total_core_count = 0;
+        for(auto const& node : nodes)
+        {
+            total_core_count += node.cores.size();
+        }
+        std::vector<uint32_t> node_partition_counts(nodes.size(), 0);
+        for(uint32_t partition_index = 0; partition_index < partition_count; ++partition_index)
+        {
+            size_t best_node = 0;
+            double best_deficit = -std::numeric_limits<double>::infinity();
+            for(size_t node_index = 0; node_index < nodes.size(); ++node_index)
+            {
+                auto const share = static_cast<double>(nodes[node_index].cores.size()) * (partition_index + 1) / static_cast<double>(total_core_count);
+                auto const deficit = share - node_partition_counts[node_index];
+                if(deficit > best_deficit)
+                {
+                    best_deficit = deficit;
+                    best_node = node_index;
+                }
+            }
+            ++node_partition_counts[best_node];
+        }
+
+        for(size_t node_index = 0; node_index < nodes.size(); ++node_index)
+        {
+            auto const& cores = nodes[node_index].cores;
+            auto const count = node_partition_counts[node_index];
+            for(uint32_t slot = 0; slot < count; ++slot)
+            {
+                core_partition partition{ .numa_node = nodes[node_index].numa_node };
+                if(count <= cores.size())
+                {
+                    auto const first = cores.size() * slot / count;
+                    auto const last = cores.size() * (slot + 1) / count;
+                    partition.cores.assign(cores.begin() + first, cores.begin() + last);
+                }
+                else
+                {
+                    partition.cores.push_back(cores[slot % cores.size()]);
+                }
+                partitions.push_back(std::move(partition));
+            }
+        }
+        return partitions;
+    }
+}
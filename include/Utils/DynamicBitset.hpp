@@ -1,12 +1,187 @@
 #pragma once
 #include "Traits/TypeTraitsExt.hpp"
+#include "Utils/BitsetKernels.hpp"
 #include <assert.h>
 #include <algorithm>
+#include <utility>
+
+// block storage with inline capacity, spills to the allocator only when it grows beyond InlineBlocks
+namespace punk
+{
+    template <typename Block, size_t InlineBlocks, typename Allocator>
+    class small_block_storage
+    {
+        static_assert(std::is_trivially_copyable_v<Block>);
+        using allocator_traits = std::allocator_traits<Allocator>;
+
+    public:
+        using value_type = Block;
+        using size_type = size_t;
+        using allocator_type = Allocator;
+        using iterator = Block*;
+        using const_iterator = Block const*;
+        static constexpr size_type inline_capacity = (std::max)(InlineBlocks, size_t{ 1 });
+
+    private:
+        Block*                              heap_ = nullptr;
+        size_type                           size_ = 0;
+        size_type                           capacity_ = inline_capacity;
+        [[no_unique_address]] Allocator     alloc_;
+        Block                               inline_[inline_capacity];
+
+    public:
+        small_block_storage() noexcept(std::is_nothrow_default_constructible_v<Allocator>) = default;
+
+        explicit small_block_storage(allocator_type const& alloc) noexcept
+            : alloc_(alloc) {}
+
+        small_block_storage(size_type count, Block value, allocator_type const& alloc = allocator_type{})
+            : alloc_(alloc)
+        {
+            resize(count, value);
+        }
+
+        small_block_storage(small_block_storage const& other)
+            : alloc_(allocator_traits::select_on_container_copy_construction(other.alloc_))
+        {
+            assign(other.data(), other.size());
+        }
+
+        small_block_storage(small_block_storage&& other) noexcept
+            : alloc_(std::move(other.alloc_))
+        {
+            steal(other);
+        }
+
+        small_block_storage& operator=(small_block_storage const& other)
+        {
+            if(this != &other)
+            {
+                assign(other.data(), other.size());
+            }
+            return *this;
+        }
+
+        small_block_storage& operator=(small_block_storage&& other) noexcept
+        {
+            if(this != &other)
+            {
+                release();
+                steal(other);
+            }
+            return *this;
+        }
+
+        ~small_block_storage()
+        {
+            release();
+        }
+
+        Block* data() noexcept { return is_inline() ? inline_ : heap_; }
+        Block const* data() const noexcept { return is_inline() ? inline_ : heap_; }
+        iterator begin() noexcept { return data(); }
+        iterator end() noexcept { return data() + size_; }
+        const_iterator begin() const noexcept { return data(); }
+        const_iterator end() const noexcept { return data() + size_; }
+        const_iterator cbegin() const noexcept { return begin(); }
+        const_iterator cend() const noexcept { return end(); }
+        Block& operator[](size_type pos) noexcept { return data()[pos]; }
+        Block const& operator[](size_type pos) const noexcept { return data()[pos]; }
+        Block& back() noexcept { return data()[size_ - 1]; }
+        Block const& back() const noexcept { return data()[size_ - 1]; }
+        size_type size() const noexcept { return size_; }
+        size_type capacity() const noexcept { return capacity_; }
+        bool empty() const noexcept { return size_ == 0; }
+        bool is_inline() const noexcept { return capacity_ == inline_capacity; }
+        allocator_type get_allocator() const noexcept { return alloc_; }
+
+        void clear() noexcept
+        {
+            size_ = 0;
+        }
+
+        void reserve(size_type capacity)
+        {
+            if(capacity <= capacity_)
+            {
+                return;
+            }
+
+            auto* new_heap = allocator_traits::allocate(alloc_, capacity);
+            std::copy_n(data(), size_, new_heap);
+            release();
+            heap_ = new_heap;
+            capacity_ = capacity;
+        }
+
+        void resize(size_type count, Block value = Block{})
+        {
+            if(count > capacity_)
+            {
+                reserve((std::max)(count, capacity_ * 2));
+            }
+            if(count > size_)
+            {
+                std::fill(data() + size_, data() + count, value);
+            }
+            size_ = count;
+        }
+
+        void push_back(Block value)
+        {
+            resize(size_ + 1, value);
+        }
+
+        void swap(small_block_storage& other) noexcept
+        {
+            auto temp = std::move(other);
+            other = std::move(*this);
+            *this = std::move(temp);
+        }
+
+    private:
+        void assign(Block const* blocks, size_type count)
+        {
+            size_ = 0;
+            reserve(count);
+            std::copy_n(blocks, count, data());
+            size_ = count;
+        }
+
+        // take the heap block, or copy the inline blocks
+        void steal(small_block_storage& other) noexcept
+        {
+            if(other.is_inline())
+            {
+                std::copy_n(other.inline_, other.size_, inline_);
+                heap_ = nullptr;
+                capacity_ = inline_capacity;
+            }
+            else
+            {
+                heap_ = std::exchange(other.heap_, nullptr);
+                capacity_ = std::exchange(other.capacity_, inline_capacity);
+            }
+            size_ = std::exchange(other.size_, 0);
+        }
+
+        void release() noexcept
+        {
+            if(!is_inline())
+            {
+                allocator_traits::deallocate(alloc_, heap_, capacity_);
+                heap_ = nullptr;
+                capacity_ = inline_capacity;
+            }
+        }
+    };
+}
 
 // re-implement dynamic bitset
 namespace punk
 {
-    template <typename Block = uint64_t, typename Allocator = std::allocator<Block>>
+    // InlineBlocks blocks are stored in the bitset itself, 256 bits by default, which covers most archetype signatures
+    template <typename Block = uint64_t, typename Allocator = std::allocator<Block>, size_t InlineBlocks = 4>
     class dynamic_bitset
     {
         static_assert(std::conjunction_v<std::negation<is_bool<Block>>, std::is_unsigned<Block>>);
@@ -14,7 +189,7 @@ namespace punk
     public: // export types
         using block_type = Block;
         using allocator_type = Allocator;
-        using storage_type = std::vector<block_type, allocator_type>;
+        using storage_type = small_block_storage<block_type, InlineBlocks, allocator_type>;
         using block_width_type = typename storage_type::size_type;
         using size_type = size_t;
 
@@ -23,6 +198,8 @@ namespace punk
         static constexpr size_type npos = (std::numeric_limits<size_type>::max)();
         static constexpr block_type ones = (std::numeric_limits<block_type>::max)();
         static constexpr block_type zeros = 0;
+        // the bulk operations go through the simd kernels for 64-bit blocks
+        static constexpr bool use_bitset_kernels = std::is_same_v<block_type, uint64_t>;
 
     public: // static functions
         template <typename CharType>
@@ -65,13 +242,15 @@ namespace punk
 
         static constexpr block_type bit_mask(size_type pos) noexcept
         {
-            return block_type{ 1 } >> bit_index(pos);
+            return block_type{ 1 } << bit_index(pos);
         }
 
+        // mask of the bits [begin, end) inside one block, begin < end <= bits_per_block
         static constexpr block_type bit_mask(size_type begin, size_type end) noexcept
         {
-            auto mask = end == bits_per_block - 1 ? ones :
-                (block_type{ 1 } << (end + 1)) - 1;
+            assert(begin < end && end <= bits_per_block);
+            auto const mask = end == bits_per_block ? ones : (block_type{ 1 } << end) - 1;
+            return mask & (ones << begin);
         }
 
         static constexpr size_type calc_num_blocks(size_type num_bits) noexcept
@@ -171,7 +350,7 @@ namespace punk
         // block & block mask as reference type
         class reference
         {
-            friend class dynamic_bitset<Block, Allocator>;
+            friend class dynamic_bitset;
             reference(block_type& block, block_width_type pos) noexcept
                 : block_(block)
                 , mask_(block_type{ 1 } << pos)
@@ -250,7 +429,7 @@ namespace punk
 
             void reset() noexcept
             {
-                block_ &= mask_;
+                block_ &= ~mask_;
             }
 
             void flip_impl() noexcept
@@ -275,7 +454,7 @@ namespace punk
                 throw std::out_of_range{ "access out of range." };
             }
 
-            auto const block_idx = bit_index(pos);
+            auto const block_idx = block_index(pos);
             auto const bit_idx = bit_index(pos);
             return reference{ storage_[block_idx], bit_idx };
         }
@@ -302,26 +481,38 @@ namespace punk
             }
 
             auto const size = storage_.size() - 1;
-            for(block_width_type loop = 0; loop < size; ++loop)
+            if constexpr(use_bitset_kernels)
             {
-                if(storage_[loop] != ones)
+                if(!get_bitset_kernels().all_ones_blocks(storage_.data(), size))
                 {
                     return false;
                 }
             }
-
-            auto const extra_bit_idx = bit_index(num_bits_);
-            if(extra_bit_idx > 0)
+            else
             {
-                auto const mask = (block_type{ 1 } << extra_bit_idx) - 1;
-                return (storage_.back() & mask) == mask;
+                for(block_width_type loop = 0; loop < size; ++loop)
+                {
+                    if(storage_[loop] != ones)
+                    {
+                        return false;
+                    }
+                }
             }
-            return storage_.back() == ones;
+
+            auto const mask = tail_mask();
+            return (storage_.back() & mask) == mask;
         }
 
         bool any() const noexcept
         {
-            return std::ranges::any_of(storage_, [](auto const elem) { return elem != zeros; });
+            if(empty())
+            {
+                return false;
+            }
+
+            // bits past the end are not cleared by set() & flip()
+            auto const size = storage_.size() - 1;
+            return find_nonzero_block(0, size) < size || (storage_.back() & tail_mask()) != zeros;
         }
 
         bool none() const noexcept
@@ -336,33 +527,92 @@ namespace punk
                 return 0;
             }
 
-            auto result = std::reduce(storage_.cbegin(), storage_.cend() - 1, size_type{ 0 },
-                [](size_type acc, block_type elem)
-                {
-                    return acc + static_cast<size_type>(std::popcount(elem));
-                });
-
-            auto const bit_idx = bit_index(num_bits_);
-            if(bit_idx > 0)
+            size_type result;
+            if constexpr(use_bitset_kernels)
             {
-                auto const mask = (block_type{ 1 } << bit_idx) - 1;
-                result += static_cast<size_type>(std::popcount(storage_.back() & mask));
+                result = get_bitset_kernels().popcount_blocks(storage_.data(), storage_.size() - 1);
             }
             else
             {
-                result += static_cast<size_type>(std::popcount(storage_.back()));
+                result = std::reduce(storage_.cbegin(), storage_.cend() - 1, size_type{ 0 },
+                    [](size_type acc, block_type elem)
+                    {
+                        return acc + static_cast<size_type>(std::popcount(elem));
+                    });
             }
-            return result;
+            return result + static_cast<size_type>(std::popcount(storage_.back() & tail_mask()));
         }
 
+        // position of the first set bit, npos if there is none
         size_type find_first() const noexcept
         {
-            return size_type{ 0 };
+            return find_from(0);
         }
 
+        // position of the first set bit after pos, npos if there is none
         size_type find_next(size_type pos) const noexcept
         {
-            return size_type{ 0 };
+            return pos == npos ? npos : find_from(pos + 1);
+        }
+
+        // position of the first zero bit, npos if there is none
+        size_type find_first_zero() const noexcept
+        {
+            return find_zero_from(0);
+        }
+
+        // position of the first zero bit after pos, npos if there is none
+        size_type find_next_zero(size_type pos) const noexcept
+        {
+            return pos == npos ? npos : find_zero_from(pos + 1);
+        }
+
+        // count of the set bits in [pos, pos + len)
+        size_type popcount_range(size_type pos, size_type len) const
+        {
+            check_range(pos, len);
+            size_type result = 0;
+            for_each_range_block(pos, len,
+                [this, &result](block_width_type first, block_width_type last)
+                {
+                    if constexpr(use_bitset_kernels)
+                    {
+                        result += get_bitset_kernels().popcount_blocks(storage_.data() + first, last - first);
+                    }
+                    else
+                    {
+                        for(; first < last; ++first)
+                        {
+                            result += static_cast<size_type>(std::popcount(storage_[first]));
+                        }
+                    }
+                },
+                [this, &result](block_width_type block_idx, block_type mask)
+                {
+                    result += static_cast<size_type>(std::popcount(storage_[block_idx] & mask));
+                });
+            return result;
+        }
+
+        // visit the positions of the set bits in ascending order
+        template <typename F>
+        void for_each_set(F&& f) const
+        {
+            if(empty())
+            {
+                return;
+            }
+
+            auto const last = block_size() - 1;
+            for(block_width_type block_idx = 0; block_idx <= last; ++block_idx)
+            {
+                auto bits = block_idx == last ? storage_[block_idx] & tail_mask() : storage_[block_idx];
+                auto const offset = static_cast<size_type>(block_idx) * bits_per_block;
+                for(; bits != zeros; bits &= bits - 1)
+                {
+                    f(offset + static_cast<size_type>(std::countr_zero(bits)));
+                }
+            }
         }
 
         block_type* data() noexcept
@@ -422,7 +672,7 @@ namespace punk
             if(&other != this)
             {
                 std::swap(num_bits_, other.num_bits_);
-                std::swap(storage_, other.storage_);
+                storage_.swap(other.storage_);
             }
         }
 
@@ -476,9 +726,16 @@ namespace punk
             if(&other != this)
             {
                 assert(other.size() == size());
-                for(block_width_type loop = 0; loop < other.block_size(); ++loop)
+                if constexpr(use_bitset_kernels)
                 {
-                    storage_[loop] &= other.storage_[loop];
+                    get_bitset_kernels().and_blocks(storage_.data(), other.storage_.data(), other.block_size());
+                }
+                else
+                {
+                    for(block_width_type loop = 0; loop < other.block_size(); ++loop)
+                    {
+                        storage_[loop] &= other.storage_[loop];
+                    }
                 }
             }
             return *this;
@@ -490,9 +747,16 @@ namespace punk
             if(&other != this)
             {
                 assert(other.size() == size());
-                for(block_width_type loop = 0; loop < other.block_size(); ++loop)
+                if constexpr(use_bitset_kernels)
                 {
-                    storage_[loop] |= other.storage_[loop];
+                    get_bitset_kernels().or_blocks(storage_.data(), other.storage_.data(), other.block_size());
+                }
+                else
+                {
+                    for(block_width_type loop = 0; loop < other.block_size(); ++loop)
+                    {
+                        storage_[loop] |= other.storage_[loop];
+                    }
                 }
             }
             return *this;
@@ -504,9 +768,16 @@ namespace punk
             if(&other != this)
             {
                 assert(other.size() == size());
-                for(block_width_type loop = 0; loop < other.block_size(); ++loop)
+                if constexpr(use_bitset_kernels)
+                {
+                    get_bitset_kernels().xor_blocks(storage_.data(), other.storage_.data(), other.block_size());
+                }
+                else
                 {
-                    storage_[loop] ^= other.storage_[loop];
+                    for(block_width_type loop = 0; loop < other.block_size(); ++loop)
+                    {
+                        storage_[loop] ^= other.storage_[loop];
+                    }
                 }
             }
             return *this;
@@ -543,7 +814,7 @@ namespace punk
 
         dynamic_bitset& set() noexcept
         {
-            std::ranges::fill_n(storage_, storage_.size(), ones);
+            std::ranges::fill(storage_, ones);
             return *this;
         }
         dynamic_bitset& set(size_type pos, bool value = true)
@@ -565,16 +836,31 @@ namespace punk
             }
             return *this;
         }
+        // set [pos, pos + len) to value
         dynamic_bitset& set(size_type pos, size_type len, bool value)
         {
-            // TODO ...
+            if(!value)
+            {
+                return reset(pos, len);
+            }
+
+            check_range(pos, len);
+            for_each_range_block(pos, len,
+                [this](block_width_type first, block_width_type last)
+                {
+                    std::fill(storage_.begin() + first, storage_.begin() + last, ones);
+                },
+                [this](block_width_type block_idx, block_type mask)
+                {
+                    storage_[block_idx] |= mask;
+                });
             return *this;
         }
 
         /// reset
         dynamic_bitset& reset() noexcept
         {
-            std::ranges::fill_n(storage_, storage_.size(), zeros);
+            std::ranges::fill(storage_, zeros);
             return *this;
         }
         dynamic_bitset& reset(size_type pos)
@@ -588,7 +874,16 @@ namespace punk
         }
         dynamic_bitset& reset(size_type pos, size_type len)
         {
-            // TODO ...
+            check_range(pos, len);
+            for_each_range_block(pos, len,
+                [this](block_width_type first, block_width_type last)
+                {
+                    std::fill(storage_.begin() + first, storage_.begin() + last, zeros);
+                },
+                [this](block_width_type block_idx, block_type mask)
+                {
+                    storage_[block_idx] &= ~mask;
+                });
             return *this;
         }
 
@@ -612,7 +907,19 @@ namespace punk
         }
         dynamic_bitset& flip(size_type pos, size_type len)
         {
-            // TODO ...
+            check_range(pos, len);
+            for_each_range_block(pos, len,
+                [this](block_width_type first, block_width_type last)
+                {
+                    for(; first < last; ++first)
+                    {
+                        storage_[first] = ~storage_[first];
+                    }
+                },
+                [this](block_width_type block_idx, block_type mask)
+                {
+                    storage_[block_idx] ^= mask;
+                });
             return *this;
         }
 
@@ -685,6 +992,118 @@ namespace punk
             }
         }
         
+        // mask of the valid bits in the last block
+        block_type tail_mask() const noexcept
+        {
+            auto const bit_idx = bit_index(num_bits_);
+            return bit_idx > 0 ? (block_type{ 1 } << bit_idx) - 1 : ones;
+        }
+
+        // index of the first non-zero block in [first, last), last if there is none
+        block_width_type find_nonzero_block(block_width_type first, block_width_type last) const noexcept
+        {
+            if constexpr(use_bitset_kernels)
+            {
+                return first + get_bitset_kernels().find_nonzero_block(storage_.data() + first, last - first);
+            }
+            else
+            {
+                while(first < last && storage_[first] == zeros)
+                {
+                    ++first;
+                }
+                return first;
+            }
+        }
+
+        size_type find_from(size_type pos) const noexcept
+        {
+            if(pos >= num_bits_)
+            {
+                return npos;
+            }
+
+            auto block_idx = block_index(pos);
+            auto bits = storage_[block_idx] & (ones << bit_index(pos));
+            if(bits == zeros)
+            {
+                block_idx = find_nonzero_block(block_idx + 1, block_size());
+                if(block_idx == block_size())
+                {
+                    return npos;
+                }
+                bits = storage_[block_idx];
+            }
+
+            // a set bit past the end is garbage
+            auto const result = block_idx * bits_per_block + static_cast<size_type>(std::countr_zero(bits));
+            return result < num_bits_ ? result : npos;
+        }
+
+        size_type find_zero_from(size_type pos) const noexcept
+        {
+            if(pos >= num_bits_)
+            {
+                return npos;
+            }
+
+            auto block_idx = block_index(pos);
+            auto bits = ~storage_[block_idx] & (ones << bit_index(pos));
+            while(bits == zeros && ++block_idx < block_size())
+            {
+                bits = ~storage_[block_idx];
+            }
+            if(bits == zeros)
+            {
+                return npos;
+            }
+
+            // a zero bit past the end is garbage
+            auto const result = block_idx * bits_per_block + static_cast<size_type>(std::countr_zero(bits));
+            return result < num_bits_ ? result : npos;
+        }
+
+        void check_range(size_type pos, size_type len) const
+        {
+            if(pos > num_bits_ || len > num_bits_ - pos)
+            {
+                throw std::out_of_range{ "access out of range." };
+            }
+        }
+
+        // split [pos, pos + len) into the whole blocks [first, last) and the partial head & tail blocks with their masks
+        template <typename WholeBlocks, typename PartialBlock>
+        void for_each_range_block(size_type pos, size_type len, WholeBlocks&& whole_blocks, PartialBlock&& partial_block) const
+        {
+            if(len == 0)
+            {
+                return;
+            }
+
+            auto const end = pos + len;
+            auto first = static_cast<block_width_type>(block_index(pos));
+            auto const last = static_cast<block_width_type>(block_index(end));
+            if(first == last)
+            {
+                partial_block(first, bit_mask(bit_index(pos), bit_index(end)));
+                return;
+            }
+
+            if(bit_index(pos) != 0)
+            {
+                partial_block(first, bit_mask(bit_index(pos), bits_per_block));
+                ++first;
+            }
+            if(first < last)
+            {
+                whole_blocks(first, last);
+            }
+            if(bit_index(end) != 0)
+            {
+                partial_block(last, bit_mask(0, bit_index(end)));
+            }
+        }
+
         bool test_impl(size_type pos) const
         {
             auto const block_idx = block_index(pos);
@@ -729,41 +1148,47 @@ namespace punk
         }
 
     public: // friends
-        template <typename Block1, typename Allocator1>
-        friend bool operator==(dynamic_bitset<Block1, Allocator1> const& lhs, dynamic_bitset<Block1, Allocator1> const& rhs) noexcept
+        friend bool operator==(dynamic_bitset const& lhs, dynamic_bitset const& rhs) noexcept
         {
-            return lhs.num_bits_ == rhs.num_bits_ && std::memcmp(lhs.data(), rhs.data(), lhs.num_bits_ / sizeof(uint8_t));
+            if(lhs.num_bits_ != rhs.num_bits_)
+            {
+                return false;
+            }
+            if(lhs.empty())
+            {
+                return true;
+            }
+
+            // bits past the end are ignored
+            auto const last = lhs.block_size() - 1;
+            return std::equal(lhs.storage_.begin(), lhs.storage_.begin() + last, rhs.storage_.begin())
+                && ((lhs.storage_.back() ^ rhs.storage_.back()) & lhs.tail_mask()) == zeros;
         }
 
-        template <typename Block1, typename Allocator1>
-        friend bool operator!=(dynamic_bitset<Block1, Allocator1> const& lhs, dynamic_bitset<Block1, Allocator1> const& rhs) noexcept
+        friend bool operator!=(dynamic_bitset const& lhs, dynamic_bitset const& rhs) noexcept
         {
             return !(lhs == rhs);
         }
 
-        template <typename Block1, typename Allocator1>
-        friend dynamic_bitset<Block1, Allocator1> operator&(dynamic_bitset<Block1, Allocator1> const& lhs, dynamic_bitset<Block1, Allocator1> const& rhs)
+        friend dynamic_bitset operator&(dynamic_bitset const& lhs, dynamic_bitset const& rhs)
         {
-            dynamic_bitset<Block1, Allocator1> result{ lhs };
+            dynamic_bitset result{ lhs };
             return result &= rhs;
         }
 
-        template <typename Block1, typename Allocator1>
-        friend dynamic_bitset<Block1, Allocator1> operator|(dynamic_bitset<Block1, Allocator1> const& lhs, dynamic_bitset<Block1, Allocator1> const& rhs)
+        friend dynamic_bitset operator|(dynamic_bitset const& lhs, dynamic_bitset const& rhs)
         {
-            dynamic_bitset<Block1, Allocator1> result{ lhs };
+            dynamic_bitset result{ lhs };
             return result |= rhs;
         }
 
-        template <typename Block1, typename Allocator1>
-        friend dynamic_bitset<Block1, Allocator1> operator^(dynamic_bitset<Block1, Allocator1> const& lhs, dynamic_bitset<Block1, Allocator1> const& rhs)
+        friend dynamic_bitset operator^(dynamic_bitset const& lhs, dynamic_bitset const& rhs)
         {
-            dynamic_bitset<Block1, Allocator1> result{ lhs };
+            dynamic_bitset result{ lhs };
             return result ^= rhs;
         }
 
-        template <typename Block1, typename Allocator1>
-        void swap(dynamic_bitset<Block1, Allocator1>& lhs, dynamic_bitset<Block1, Allocator1>& rhs)
+        friend void swap(dynamic_bitset& lhs, dynamic_bitset& rhs) noexcept
         {
             lhs.swap(rhs);
         }
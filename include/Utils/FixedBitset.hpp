@@ -0,0 +1,235 @@
+#pragma once
+
+#include "Types/Forward.hpp"
+#include <algorithm>
+#include <cassert>
+
+// fixed size bitset usable in constant expressions, for signatures whose width is known at compile time
+namespace punk
+{
+    template <size_t NumBits>
+    class fixed_bitset
+    {
+    public:
+        using block_type = uint64_t;
+        using size_type = size_t;
+        static constexpr size_type bits_per_block = std::numeric_limits<block_type>::digits;
+        static constexpr size_type block_count = (std::max)((NumBits + bits_per_block - 1) / bits_per_block, size_type{ 1 });
+        static constexpr size_type npos = (std::numeric_limits<size_type>::max)();
+        static constexpr block_type ones = (std::numeric_limits<block_type>::max)();
+        static constexpr block_type zeros = 0;
+        // mask of the valid bits in the last block, the bits past the end are always zero
+        static constexpr block_type tail_mask = NumBits == 0 ? zeros :
+            NumBits % bits_per_block == 0 ? ones : (block_type{ 1 } << (NumBits % bits_per_block)) - 1;
+
+    private:
+        std::array<block_type, block_count> blocks_{};
+
+    public:
+        constexpr fixed_bitset() noexcept = default;
+
+        // construct from the positions of the set bits, fixed_bitset<N>{ 5 } sets bit 5
+        constexpr fixed_bitset(std::initializer_list<size_type> positions) noexcept
+        {
+            for(auto const pos : positions)
+            {
+                set(pos);
+            }
+        }
+
+        // the first block holds the bits of word, the bits past the end are dropped
+        static constexpr fixed_bitset from_word(uint64_t word) noexcept
+        {
+            fixed_bitset result;
+            result.blocks_[0] = block_count == 1 ? (word & tail_mask) : word;
+            return result;
+        }
+
+    public: // member access
+        constexpr bool test(size_type pos) const noexcept
+        {
+            assert(pos < NumBits);
+            return (blocks_[pos / bits_per_block] >> (pos % bits_per_block)) & 1;
+        }
+
+        constexpr bool operator[](size_type pos) const noexcept
+        {
+            return test(pos);
+        }
+
+        constexpr bool all() const noexcept
+        {
+            for(size_type loop = 0; loop + 1 < block_count; ++loop)
+            {
+                if(blocks_[loop] != ones)
+                {
+                    return false;
+                }
+            }
+            return blocks_.back() == tail_mask;
+        }
+
+        constexpr bool any() const noexcept
+        {
+            return std::ranges::any_of(blocks_, [](block_type block) { return block != zeros; });
+        }
+
+        constexpr bool none() const noexcept
+        {
+            return !any();
+        }
+
+        constexpr size_type count() const noexcept
+        {
+            size_type result = 0;
+            for(auto const block : blocks_)
+            {
+                result += static_cast<size_type>(std::popcount(block));
+            }
+            return result;
+        }
+
+        // every bit set in other is set in this
+        constexpr bool contains(fixed_bitset const& other) const noexcept
+        {
+            for(size_type loop = 0; loop < block_count; ++loop)
+            {
+                if((other.blocks_[loop] & ~blocks_[loop]) != zeros)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        constexpr size_type find_first() const noexcept
+        {
+            return find_from(0);
+        }
+
+        constexpr size_type find_next(size_type pos) const noexcept
+        {
+            return pos == npos ? npos : find_from(pos + 1);
+        }
+
+        constexpr block_type const* data() const noexcept
+        {
+            return blocks_.data();
+        }
+
+        static constexpr size_type size() noexcept
+        {
+            return NumBits;
+        }
+
+    public: // modifiers
+        constexpr fixed_bitset& set() noexcept
+        {
+            blocks_.fill(ones);
+            blocks_.back() = tail_mask;
+            return *this;
+        }
+
+        constexpr fixed_bitset& set(size_type pos, bool value = true) noexcept
+        {
+            assert(pos < NumBits);
+            auto const mask = block_type{ 1 } << (pos % bits_per_block);
+            auto& block = blocks_[pos / bits_per_block];
+            block = value ? (block | mask) : (block & ~mask);
+            return *this;
+        }
+
+        constexpr fixed_bitset& reset() noexcept
+        {
+            blocks_.fill(zeros);
+            return *this;
+        }
+
+        constexpr fixed_bitset& reset(size_type pos) noexcept
+        {
+            return set(pos, false);
+        }
+
+        constexpr fixed_bitset& flip() noexcept
+        {
+            for(auto& block : blocks_)
+            {
+                block = ~block;
+            }
+            blocks_.back() &= tail_mask;
+            return *this;
+        }
+
+        constexpr fixed_bitset& flip(size_type pos) noexcept
+        {
+            assert(pos < NumBits);
+            blocks_[pos / bits_per_block] ^= block_type{ 1 } << (pos % bits_per_block);
+            return *this;
+        }
+
+        constexpr fixed_bitset& operator&=(fixed_bitset const& other) noexcept
+        {
+            for(size_type loop = 0; loop < block_count; ++loop)
+            {
+                blocks_[loop] &= other.blocks_[loop];
+            }
+            return *this;
+        }
+
+        constexpr fixed_bitset& operator|=(fixed_bitset const& other) noexcept
+        {
+            for(size_type loop = 0; loop < block_count; ++loop)
+            {
+                blocks_[loop] |= other.blocks_[loop];
+            }
+            return *this;
+        }
+
+        constexpr fixed_bitset& operator^=(fixed_bitset const& other) noexcept
+        {
+            for(size_type loop = 0; loop < block_count; ++loop)
+            {
+                blocks_[loop] ^= other.blocks_[loop];
+            }
+            return *this;
+        }
+
+        constexpr fixed_bitset operator~() const noexcept
+        {
+            fixed_bitset result{ *this };
+            return result.flip();
+        }
+
+    public: // friends
+        friend constexpr bool operator==(fixed_bitset const& lhs, fixed_bitset const& rhs) noexcept = default;
+
+        friend constexpr fixed_bitset operator&(fixed_bitset lhs, fixed_bitset const& rhs) noexcept
+        {
+            return lhs &= rhs;
+        }
+
+        friend constexpr fixed_bitset operator|(fixed_bitset lhs, fixed_bitset const& rhs) noexcept
+        {
+            return lhs |= rhs;
+        }
+
+        friend constexpr fixed_bitset operator^(fixed_bitset lhs, fixed_bitset const& rhs) noexcept
+        {
+            return lhs ^= rhs;
+        }
+
+    private:
+        constexpr size_type find_from(size_type pos) const noexcept
+        {
+            for(auto block = pos / bits_per_block; block < block_count && pos < NumBits; ++block)
+            {
+                auto const bits = blocks_[block] & (block * bits_per_block < pos ? ones << (pos % bits_per_block) : ones);
+                if(bits != zeros)
+                {
+                    return block * bits_per_block + static_cast<size_type>(std::countr_zero(bits));
+                }
+            }
+            return npos;
+        }
+    };
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+
 namespace punk
 {
     constexpr uint32_t murmur_rotl(uint32_t x, int8_t r) noexcept
@@ -103,6 +105,149 @@ namespace punk
         return murmur_hash_x86_32(arr, static_cast<int>(len), ecs_seed);
     }
 
+    // murmur3 x64_128, the constexpr form reads bytes, the runtime form loads whole 64-bit words
+    struct hash128_t
+    {
+        uint64_t low;
+        uint64_t high;
+
+        friend constexpr bool operator==(hash128_t const&, hash128_t const&) noexcept = default;
+    };
+
+    constexpr uint64_t murmur_rotl64(uint64_t x, int8_t r) noexcept
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    constexpr uint64_t murmur_get_block64(char const* p, size_t i)
+    {
+        size_t const offset = i * 8;
+        if(!std::is_constant_evaluated())
+        {
+            uint64_t block;
+            std::memcpy(&block, p + offset, sizeof(block));
+            return block;
+        }
+
+        uint64_t block = 0;
+        for(size_t loop = 0; loop < 8; ++loop)
+        {
+            block |= static_cast<uint64_t>(static_cast<uint8_t>(p[offset + loop])) << (loop * 8);
+        }
+        return block;
+    }
+
+    constexpr uint64_t murmur_fmix64(uint64_t const k) noexcept
+    {
+        uint64_t result = k;
+        result ^= result >> 33;
+        result *= 0xff51afd7ed558ccdull;
+        result ^= result >> 33;
+        result *= 0xc4ceb9fe1a85ec53ull;
+        result ^= result >> 33;
+        return result;
+    }
+
+    constexpr hash128_t murmurhash3_x64_128_impl(char const* key, size_t const len, uint64_t const seed)
+    {
+        size_t const nblocks = len / 16;
+
+        uint64_t h1 = seed;
+        uint64_t h2 = seed;
+
+        constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+        constexpr uint64_t c2 = 0x4cf5ad432745937full;
+
+        //----------
+        // body
+
+        for(size_t i = 0; i < nblocks; ++i)
+        {
+            uint64_t k1 = murmur_get_block64(key, i * 2 + 0);
+            uint64_t k2 = murmur_get_block64(key, i * 2 + 1);
+
+            k1 *= c1; k1 = murmur_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+            h1 = murmur_rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+            k2 *= c2; k2 = murmur_rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+            h2 = murmur_rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+        }
+
+        //----------
+        // tail
+
+        auto const tail = [key, index = nblocks * 16](size_t offset)
+            {
+                return static_cast<uint64_t>(static_cast<uint8_t>(key[index + offset]));
+            };
+
+        uint64_t k1 = 0u;
+        uint64_t k2 = 0u;
+        switch(len & 15)
+        {
+        case 15: k2 ^= tail(14) << 48; [[fallthrough]];
+        case 14: k2 ^= tail(13) << 40; [[fallthrough]];
+        case 13: k2 ^= tail(12) << 32; [[fallthrough]];
+        case 12: k2 ^= tail(11) << 24; [[fallthrough]];
+        case 11: k2 ^= tail(10) << 16; [[fallthrough]];
+        case 10: k2 ^= tail(9) << 8; [[fallthrough]];
+        case  9: k2 ^= tail(8);
+                 k2 *= c2; k2 = murmur_rotl64(k2, 33); k2 *= c1; h2 ^= k2; [[fallthrough]];
+        case  8: k1 ^= tail(7) << 56; [[fallthrough]];
+        case  7: k1 ^= tail(6) << 48; [[fallthrough]];
+        case  6: k1 ^= tail(5) << 40; [[fallthrough]];
+        case  5: k1 ^= tail(4) << 32; [[fallthrough]];
+        case  4: k1 ^= tail(3) << 24; [[fallthrough]];
+        case  3: k1 ^= tail(2) << 16; [[fallthrough]];
+        case  2: k1 ^= tail(1) << 8; [[fallthrough]];
+        case  1: k1 ^= tail(0);
+                 k1 *= c1; k1 = murmur_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        }
+
+        //----------
+        // finalization
+
+        h1 ^= len;
+        h2 ^= len;
+
+        h1 += h2;
+        h2 += h1;
+
+        h1 = murmur_fmix64(h1);
+        h2 = murmur_fmix64(h2);
+
+        h1 += h2;
+        h2 += h1;
+
+        return { h1, h2 };
+    }
+
+    template <size_t Length>
+    constexpr hash128_t murmur_hash_x64_128(char const(&arr)[Length], uint64_t const seed)
+    {
+        return murmurhash3_x64_128_impl(arr, Length - 1, seed);
+    }
+
+    inline hash128_t murmur_hash_x64_128(char const* arr, size_t const len, uint64_t const seed)
+    {
+        return murmurhash3_x64_128_impl(arr, len, seed);
+    }
+
+    template <size_t Length>
+    constexpr uint64_t hash_memory_64(char const(&arr)[Length])
+    {
+        // hex from of 'x' 'e' 'c' 's'
+        constexpr uint64_t ecs_seed = 0x78656373;
+        return murmur_hash_x64_128(arr, ecs_seed).low;
+    }
+
+    inline uint64_t hash_memory_64(char const* arr, size_t const len)
+    {
+        // hex from of 'x' 'e' 'c' 's'
+        constexpr uint64_t ecs_seed = 0x78656373;
+        return murmur_hash_x64_128(arr, len, ecs_seed).low;
+    }
+
     // TODO ... move to a better header
     template <typename T> requires(std::is_integral_v<T>)
     constexpr T align_up_with_mask(T value, T mask)
@@ -119,12 +264,12 @@ namespace punk
     template <typename T> requires(std::is_integral_v<T>)
     constexpr T align_up(T value, T alignment)
     {
-        return align_up_with_mask(value, std::bit_ceil(alignment));
+        return align_up_with_mask(value, static_cast<T>(std::bit_ceil(alignment) - 1));
     }
 
     template <typename T> requires(std::is_integral_v<T>)
     constexpr T align_down(T value, T alignment)
     {
-        return align_down_with_mask(value, std::bit_ceil(alignment));
+        return align_down_with_mask(value, static_cast<T>(std::bit_ceil(alignment) - 1));
     }
 }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "Types/Forward.hpp"
-#include "Utils/DynamicBitset.hpp"
+#include "Utils/Hash.hpp"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
 
 namespace punk
 {
+    // a hive group lives in one aligned block obtained from the allocator:
+    // | hive_group header | occupancy bits | element storage |
     template <typename T, typename Alloc = std::allocator<T>>
     class hive_group
     {
@@ -15,35 +21,65 @@ namespace punk
         using const_value = std::add_const_t<value_type>;
         using pointer = std::add_pointer_t<value_type>;
         using const_pointer = std::add_pointer_t<const_value>;
+        using bits_block_type = uint64_t;
         static constexpr size_t value_size = sizeof(value_type);
         static constexpr size_t value_align = alignof(value_type);
-        struct element_storage
+        static constexpr size_t bits_per_block = std::numeric_limits<bits_block_type>::digits;
+        static constexpr size_t block_alignment = (std::max)({ value_align, alignof(bits_block_type), alignof(size_t) });
+        struct alignas(block_alignment) group_block
         {
-            alignas(T) std::array<uint8_t, value_size> bytes_;
+            std::byte bytes_[block_alignment];
         };
-        using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<element_storage>;
-        using storage_type = std::vector<element_storage, allocator_type>;
+        using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<group_block>;
         static_assert(value_size >= sizeof(uint32_t));
-        static_assert(value_size == sizeof(element_storage));
 
     private:
-        storage_type        storage_;
-        dynamic_bitset<>    storage_bits_;
+        size_t const        capacity_;
+        size_t const        first_global_index_;
         uint32_t            first_available_index_;
         uint32_t            available_element_count_;
-        size_t const        first_global_index_;
 
-    public:
-        explicit hive_group(size_t element_count, size_t first_global_index)
-            : storage_(element_count)
-            , storage_bits_(element_count, false)
-            , first_available_index_(0)
-            , available_element_count_(element_count)
+        hive_group(size_t element_count, size_t first_global_index) noexcept
+            : capacity_(element_count)
             , first_global_index_(first_global_index)
+            , first_available_index_(0)
+            , available_element_count_(static_cast<uint32_t>(element_count))
         {
+            // capacity is a multiple of the bits block, so there is no tail in the last block
+            assert(element_count % bits_per_block == 0 && element_count <= (std::numeric_limits<uint32_t>::max)());
             init(element_count);
         }
 
+        ~hive_group()
+        {
+            if constexpr(std::negation_v<std::is_trivially_destructible<value_type>>)
+            {
+                // destroy the remaining elements
+                for(auto index = find_allocated(0); index < capacity(); index = find_allocated(index + 1))
+                {
+                    get_ptr_as<value_type>(index)->~value_type();
+                }
+            }
+        }
+
+    public:
+        hive_group(hive_group const&) = delete;
+        hive_group& operator=(hive_group const&) = delete;
+
+        // allocate the whole group in one block
+        static hive_group* create(size_t element_count, size_t first_global_index)
+        {
+            auto* block = allocator_type{}.allocate(get_block_count(element_count));
+            return new (block) hive_group{ element_count, first_global_index };
+        }
+
+        static void destroy(hive_group* group) noexcept
+        {
+            auto const block_count = get_block_count(group->capacity());
+            group->~hive_group();
+            allocator_type{}.deallocate(reinterpret_cast<group_block*>(group), block_count);
+        }
+
         pointer get(size_t index)
         {
             return const_cast<pointer>(const_cast<hive_group const*>(this)->get(index));
@@ -51,8 +87,8 @@ namespace punk
 
         const_pointer get(size_t index) const
         {
-            assert(index < storage_.size());
-            if(index < storage_.size() && test(index))
+            assert(index < capacity());
+            if(index < capacity() && test(index))
             {
                 return get_ptr_as<value_type>(index);
             }
@@ -66,22 +102,29 @@ namespace punk
 
         size_t capacity() const noexcept
         {
-            return storage_.size();
+            return capacity_;
         }
 
-        bool test(size_t index) const
+        bool empty() const noexcept
         {
-            return storage_bits_.test(index);
+            return available_element_count_ == capacity();
+        }
+
+        bool test(size_t index) const noexcept
+        {
+            assert(index < capacity());
+            return (get_bits()[index / bits_per_block] >> (index % bits_per_block)) & 1;
         }
 
         bool memory_in_range(const_pointer ptr) const noexcept
         {
-            return ptr >= get_ptr(0) && ptr <= get_ptr(storage_.size() - 1);
+            auto const* byte_ptr = reinterpret_cast<uint8_t const*>(ptr);
+            return byte_ptr >= get_ptr(0) && byte_ptr <= get_ptr(capacity() - 1);
         }
 
         bool memory_aligned(const_pointer ptr) const noexcept
         {
-            std::ptrdiff_t distance = get_ptr(0) - ptr;
+            std::ptrdiff_t distance = reinterpret_cast<uint8_t const*>(ptr) - get_ptr(0);
             return distance % value_size == 0;
         }
 
@@ -95,9 +138,33 @@ namespace punk
             return first_global_index_;
         }
 
+        // index of the first allocated element at or after pos, capacity() if there is none
+        // walks the allocated bits word by word, so erased runs cost one word per 64 elements
+        size_t find_allocated(size_t pos) const noexcept
+        {
+            auto const* blocks = get_bits();
+            auto const block_count = capacity() / bits_per_block;
+            auto block = pos / bits_per_block;
+            if(block >= block_count)
+            {
+                return capacity();
+            }
+
+            auto bits = blocks[block] & (~bits_block_type{ 0 } << (pos % bits_per_block));
+            while(bits == 0)
+            {
+                if(++block == block_count)
+                {
+                    return capacity();
+                }
+                bits = blocks[block];
+            }
+            return block * bits_per_block + std::countr_zero(bits);
+        }
+
     public:
         template <typename ... Args> requires(std::constructible_from<value_type, Args&&...>)
-        auto construct(Args&& ... args) -> std::pair<pointer*, size_t>
+        auto construct(Args&& ... args) -> std::pair<pointer, size_t>
         {
             // branch: when hive group has no available space to construct a new element
             if(!has_available_space())
@@ -110,9 +177,9 @@ namespace punk
             assert(index < capacity());
             auto* construct_ptr = get_ptr(index);
 
-            // record the next available space
+            // record the next available space, capacity() marks the end of the free list
             auto const next_available_index = *reinterpret_cast<uint32_t*>(construct_ptr);
-            assert(next_available_index < capacity());
+            assert(next_available_index <= capacity());
 
             // placement new a new element
             new (construct_ptr) value_type{ std::forward<Args>(args)... };
@@ -127,7 +194,7 @@ namespace punk
             return { reinterpret_cast<pointer>(construct_ptr), index + get_first_global_index() };
         }
 
-        void destruct(pointer ptr) noexcept
+        void destruct(const_pointer ptr) noexcept
         {
             assert(available_element_count_ < capacity());
             assert(ptr);
@@ -141,33 +208,33 @@ namespace punk
             }
 
             // update new state
-            auto* space_index_ptr = reinterpret_cast<element_storage*>(ptr);
-            auto const space_index = std::distance(get_ptr_as<element_storage*>(0), space_index_ptr);
+            auto const space_index = static_cast<uint32_t>((reinterpret_cast<uint8_t const*>(ptr) - get_ptr(0)) / value_size);
             assert(space_index < capacity());
 
             // check double free
-            if(!test_allocated(space_index))
+            if(!test(space_index))
             {
                 return;
             }
 
             // call destructor
+            auto* mutable_ptr = get_ptr_as<value_type>(space_index);
             if constexpr(std::negation_v<std::is_trivially_destructible<value_type>>)
             {
-                ptr->~value_type();
+                mutable_ptr->~value_type();
             }
 
             // update hive group state
             mark_destroyed(space_index);
-            *reinterpret_cast<uint32_t*>(ptr) = first_available_index_;
+            *reinterpret_cast<uint32_t*>(mutable_ptr) = first_available_index_;
             first_available_index_ = space_index;
             available_element_count_++;
-            assert(available_element_count_ < capacity());
+            assert(available_element_count_ <= capacity());
         }
 
         void destruct(size_t pos) noexcept
         {
-            if(pos >= capacity() || !test_allocated(pos))
+            if(pos >= capacity() || !test(pos))
             {
                 return;
             }
@@ -176,8 +243,25 @@ namespace punk
         }
 
     private:
-        void init(size_t element_count)
+        static constexpr size_t get_bits_offset() noexcept
+        {
+            return align_up(sizeof(hive_group), alignof(bits_block_type));
+        }
+
+        static constexpr size_t get_storage_offset(size_t element_count) noexcept
+        {
+            return align_up(get_bits_offset() + element_count / bits_per_block * sizeof(bits_block_type), value_align);
+        }
+
+        static constexpr size_t get_block_count(size_t element_count) noexcept
         {
+            auto const size = get_storage_offset(element_count) + element_count * value_size;
+            return (size + sizeof(group_block) - 1) / sizeof(group_block);
+        }
+
+        void init(size_t element_count) noexcept
+        {
+            std::fill_n(get_bits(), element_count / bits_per_block, bits_block_type{ 0 });
             for(uint32_t loop = 0; loop < element_count; ++loop)
             {
                 auto* uint32_ptr = get_ptr_as<uint32_t>(loop);
@@ -185,45 +269,56 @@ namespace punk
             }
         }
 
-        uint8_t* get_ptr(size_t index)
+        bits_block_type* get_bits() noexcept
+        {
+            return reinterpret_cast<bits_block_type*>(reinterpret_cast<uint8_t*>(this) + get_bits_offset());
+        }
+
+        bits_block_type const* get_bits() const noexcept
         {
-            return storage_[index].bytes_.data();
+            return reinterpret_cast<bits_block_type const*>(reinterpret_cast<uint8_t const*>(this) + get_bits_offset());
         }
 
-        uint8_t const* get_ptr(size_t index) const
+        uint8_t* get_ptr(size_t index) noexcept
         {
-            return &storage_[index].bytes_.data();
+            return reinterpret_cast<uint8_t*>(this) + get_storage_offset(capacity()) + index * value_size;
+        }
+
+        uint8_t const* get_ptr(size_t index) const noexcept
+        {
+            return reinterpret_cast<uint8_t const*>(this) + get_storage_offset(capacity()) + index * value_size;
         }
 
         template <typename U>
-        U* get_ptr_as(size_t index)
+        U* get_ptr_as(size_t index) noexcept
         {
             return reinterpret_cast<U*>(get_ptr(index));
         }
 
         template <typename U>
-        U const* get_ptr_as(size_t index) const
+        U const* get_ptr_as(size_t index) const noexcept
         {
             return reinterpret_cast<U const*>(get_ptr(index));
         }
 
-        bool test_allocated(size_t pos) const
+        void mark_allocated(size_t pos) noexcept
         {
             assert(pos < capacity());
-            return storage_bits_.test(pos);
+            get_bits()[pos / bits_per_block] |= bits_block_type{ 1 } << (pos % bits_per_block);
         }
 
-        void mark_allocated(size_t pos)
+        void mark_destroyed(size_t pos) noexcept
         {
             assert(pos < capacity());
-            storage_bits_.set(pos);
+            get_bits()[pos / bits_per_block] &= ~(bits_block_type{ 1 } << (pos % bits_per_block));
         }
+    };
 
-        void mark_destroyed(size_t pos)
-        {
-            assert(pos < capacity());
-            storage_bits_.reset(pos);
-        }
+    // group k of a hive holds initial_capacity << (growth_shift * k) elements
+    struct hive_growth_policy
+    {
+        size_t      initial_capacity = 64;      // rounded up to a power of two, at least 64
+        uint32_t    growth_shift = 1;           // 1 doubles the capacity of each group, clamped to [1, 3]
     };
 
     template <typename T, typename Alloc = std::allocator<T>>
@@ -237,71 +332,193 @@ namespace punk
         using allocator_type = Alloc;
 
     private:
-        using hive_group_ptr = std::unique_ptr<hive_group_type>;
-        using hive_group_ptr_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<hive_group_ptr>;
-        using hive_group_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<hive_group_type>;
-        std::vector<hive_group_ptr, hive_group_allocator> hive_groups_;
-        size_t const initial_capacity = 64;
+        // the free list of a group stores uint32_t indices
+        static constexpr size_t max_group_capacity = size_t{ 1 } << 31;
+        static constexpr size_t max_group_count = 64;
+
+        // the groups are stored inline, a released or not created group leaves a null hole,
+        // the group of a global index is computed from the growth policy directly
+        std::array<hive_group_type*, max_group_count> hive_groups_{};
+        size_t group_count_ = 0;            // one past the last created group
+        // bit k is set when group k has available space or is not created yet,
+        // the lowest set bit is the group to construct in, which keeps elements packed in the small groups
+        uint64_t available_groups_ = 0;
+        uint32_t initial_capacity_shift_ = 0;
+        uint32_t growth_shift_ = 0;
+        uint32_t max_group_index_ = 0;      // groups past it would exceed max_group_capacity
+
+    public:
+        // forward iterator over the live elements, in global index order
+        template <bool Const>
+        class hive_iterator
+        {
+        public:
+            friend class hive;
+            using hive_type = std::conditional_t<Const, hive const, hive>;
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = typename hive::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<Const, typename hive::const_pointer, typename hive::pointer>;
+            using reference = std::add_lvalue_reference_t<std::remove_pointer_t<pointer>>;
+
+        private:
+            hive_type*  hive_ = nullptr;
+            size_t      group_index_ = 0;
+            size_t      index_in_group_ = 0;
+
+            hive_iterator(hive_type* owner, size_t group_index, size_t index_in_group) noexcept
+                : hive_(owner)
+                , group_index_(group_index)
+                , index_in_group_(index_in_group) {}
+
+        public:
+            hive_iterator() noexcept = default;
+
+            // iterator -> const_iterator
+            operator hive_iterator<true>() const noexcept requires(!Const)
+            {
+                return { hive_, group_index_, index_in_group_ };
+            }
+
+            reference operator*() const
+            {
+                return *get_group()->get(index_in_group_);
+            }
+
+            pointer operator->() const
+            {
+                return get_group()->get(index_in_group_);
+            }
+
+            hive_iterator& operator++()
+            {
+                index_in_group_ = get_group()->find_allocated(index_in_group_ + 1);
+                if(index_in_group_ == get_group()->capacity())
+                {
+                    std::tie(group_index_, index_in_group_) = hive_->find_first_in_groups(group_index_ + 1);
+                }
+                return *this;
+            }
+
+            hive_iterator operator++(int)
+            {
+                auto result = *this;
+                ++*this;
+                return result;
+            }
+
+            size_t get_global_index() const noexcept
+            {
+                return get_group()->get_first_global_index() + index_in_group_;
+            }
+
+            friend bool operator==(hive_iterator const& lhs, hive_iterator const& rhs) noexcept
+            {
+                return lhs.group_index_ == rhs.group_index_ && lhs.index_in_group_ == rhs.index_in_group_;
+            }
+
+        private:
+            auto* get_group() const noexcept
+            {
+                assert(hive_ && group_index_ < hive_->group_count_ && hive_->hive_groups_[group_index_]);
+                return hive_->hive_groups_[group_index_];
+            }
+        };
+        using iterator = hive_iterator<false>;
+        using const_iterator = hive_iterator<true>;
 
     public:
-        hive()
+        explicit hive(hive_growth_policy const& growth_policy = {})
         {
-            create_initial_group();
+            set_growth_policy(growth_policy);
         }
         ~hive()
         {
-            // TODO ...
+            release_groups();
+        }
+        hive(hive&& other) noexcept
+            : hive_groups_(std::exchange(other.hive_groups_, {}))
+            , group_count_(std::exchange(other.group_count_, 0))
+            , available_groups_(other.available_groups_)
+            , initial_capacity_shift_(other.initial_capacity_shift_)
+            , growth_shift_(other.growth_shift_)
+            , max_group_index_(other.max_group_index_)
+        {
+            other.available_groups_ = other.all_groups_available();
+        }
+        hive& operator=(hive&& other) noexcept
+        {
+            if(this != &other)
+            {
+                release_groups();
+                hive_groups_ = std::exchange(other.hive_groups_, {});
+                group_count_ = std::exchange(other.group_count_, 0);
+                available_groups_ = other.available_groups_;
+                initial_capacity_shift_ = other.initial_capacity_shift_;
+                growth_shift_ = other.growth_shift_;
+                max_group_index_ = other.max_group_index_;
+                other.available_groups_ = other.all_groups_available();
+            }
+            return *this;
         }
-        hive(hive&&) = default; // TODO ...
-        hive& operator=(hive&&) = default; // TODO ...
         hive(hive const& other) = delete; // TODO ...
         hive& operator=(hive const& other) = delete; // TODO ...
 
     public:
+        iterator begin()
+        {
+            auto const [group_index, index_in_group] = find_first_in_groups(0);
+            return { this, group_index, index_in_group };
+        }
+        iterator end() { return { this, group_count_, 0 }; }
+        const_iterator begin() const { return const_cast<hive*>(this)->begin(); }
+        const_iterator end() const { return const_cast<hive*>(this)->end(); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
         template <typename ... Args> requires(std::constructible_from<value_type, Args&&...>)
         auto construct(Args&& ... args) -> std::pair<value_type*, size_t>
         {
-            // find or create a hive_group iterator to construct our new element
-            auto itr = std::ranges::find_first_of(hive_groups_,
-                [](auto const& hive_group_ptr)
-                {
-                    return hive_group_ptr->has_available_space();
-                });
-            if(itr == hive_groups_.end())
+            // the lowest group with available space, created on demand
+            if(available_groups_ == 0)
             {
-                itr = append_new_group();
+                throw std::length_error{ "hive exceeds the max element count." };
             }
+            auto const group_index = static_cast<size_t>(std::countr_zero(available_groups_));
+            auto& hive_group = get_or_create_group(group_index);
 
-            auto result = itr->construct(std::forward<Args>(args)...);
+            auto result = hive_group.construct(std::forward<Args>(args)...);
+            if(!hive_group.has_available_space())
+            {
+                available_groups_ &= ~group_bit(group_index);
+            }
             return result;
         }
 
         void destruct(const_pointer ptr) noexcept
         {
-            auto itr = std::ranges::find_first_of(hive_groups_,
-                [=](auto const& hive_group_ptr)
-                {
-                    return hive_group_ptr->memory_in_range(ptr) && itr->memory_aligned(ptr);
-                });
-            if(itr == hive_groups_.end())
+            for(size_t group_index = 0; group_index < group_count_; ++group_index)
             {
-                return;
+                auto* hive_group = hive_groups_[group_index];
+                if(hive_group && hive_group->memory_in_range(ptr) && hive_group->memory_aligned(ptr))
+                {
+                    hive_group->destruct(ptr);
+                    on_element_destructed(group_index);
+                    return;
+                }
             }
-
-            itr->destruct(ptr);
-            // TODO ... remove empty hive group
         }
 
         const_pointer get(size_t global_index) const
         {
-            auto itr = get_hive_group(global_index);
-            if(itr == hive_groups_.cend())
+            auto const* hive_group = get_hive_group(global_index);
+            if(!hive_group)
             {
                 return nullptr;
             }
 
-            auto const index_in_group = global_index - itr->get_first_global_index();
-            return itr->get(index_in_group);
+            auto const index_in_group = global_index - hive_group->get_first_global_index();
+            return hive_group->get(index_in_group);
         }
 
         pointer get(size_t global_index)
@@ -309,72 +526,185 @@ namespace punk
             return const_cast<pointer>(const_cast<hive const*>(this)->get(global_index));
         }
 
-        void destruct(size_t index) noexcept
+        void destruct(size_t global_index) noexcept
         {
-            auto const hive_group_q = index / initial_capacity;
-            auto const hive_group_r = index % initial_capacity;
+            auto* hive_group = get_hive_group(global_index);
+            if(!hive_group)
+            {
+                return;
+            }
 
-            auto const index_of_group = static_cast<size_t>(std::bit_width(hive_group_q));
-            if(index_of_group >= hive_groups_.size())
+            auto const index_in_group = global_index - hive_group->get_first_global_index();
+            assert(index_in_group < hive_group->capacity());
+            if(!hive_group->test(index_in_group))
             {
                 return;
             }
-            auto const& hive_group_ptr = hive_groups_[index_of_group];
-            assert(hive_group_ptr);
-            assert(index >= hive_group_ptr->get_first_global_index());
-            auto const index_in_group = index - hive_group_ptr->get_first_global_index();
-            assert(index_in_group < hive_group_ptr->capacity());
-            hive_group_ptr->destruct(index_in_group);
+            hive_group->destruct(index_in_group);
+            on_element_destructed(get_group_index(global_index));
+        }
+
+    public: // capacity
+        size_t size() const noexcept
+        {
+            size_t result = 0;
+            for(size_t group_index = 0; group_index < group_count_; ++group_index)
+            {
+                result += hive_groups_[group_index] ? hive_groups_[group_index]->size() : 0;
+            }
+            return result;
+        }
+
+        size_t capacity() const noexcept
+        {
+            size_t result = 0;
+            for(size_t group_index = 0; group_index < group_count_; ++group_index)
+            {
+                result += hive_groups_[group_index] ? hive_groups_[group_index]->capacity() : 0;
+            }
+            return result;
+        }
+
+        // create all the groups covering global indices [0, element_count)
+        void reserve(size_t element_count)
+        {
+            for(size_t group_index = 0; group_index <= max_group_index_ && get_group_first_global_index(group_index) < element_count; ++group_index)
+            {
+                get_or_create_group(group_index);
+            }
+        }
+
+        // release all the empty groups, including the first one
+        void shrink_to_fit() noexcept
+        {
+            for(size_t group_index = 0; group_index < group_count_; ++group_index)
+            {
+                release_group_if_empty(group_index);
+            }
+            while(group_count_ > 0 && !hive_groups_[group_count_ - 1])
+            {
+                group_count_--;
+            }
+        }
+
+        // the policy can only be changed before any group is created
+        void set_growth_policy(hive_growth_policy const& growth_policy)
+        {
+            assert(group_count_ == 0);
+            auto const initial_capacity = std::bit_ceil((std::max)(growth_policy.initial_capacity, hive_group_type::bits_per_block));
+            initial_capacity_shift_ = static_cast<uint32_t>(std::countr_zero((std::min)(initial_capacity, max_group_capacity)));
+            growth_shift_ = std::clamp(growth_policy.growth_shift, 1u, 3u);
+            auto const max_capacity_shift = static_cast<uint32_t>(std::countr_zero(max_group_capacity));
+            max_group_index_ = (std::min)((max_capacity_shift - initial_capacity_shift_) / growth_shift_, static_cast<uint32_t>(max_group_count - 1));
+            available_groups_ = all_groups_available();
         }
 
     private:
-        void create_initial_group()
+        uint64_t all_groups_available() const noexcept
         {
-            auto initial_group = create_new_group(initial_capacity, 0);
-            hive_groups_.push_back(std::move(initial_group));
+            return max_group_index_ == 63 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << (max_group_index_ + 1)) - 1;
         }
 
-        auto append_new_group()
+        static constexpr uint64_t group_bit(size_t group_index) noexcept
         {
-            assert(!hive_groups_.empty());
-            // double capacity
-            auto const next_group_capacity = hive_groups_.back()->capacity() * 2;
-            auto const first_global_index = hive_groups_.back()->get_first_global_index() + next_group_capacity;
-            // create new group
-            auto new_hive_group = create_new_group(next_group_capacity, first_global_index);
-            hive_groups_.insert(hive_groups_.end(), std::move(new_hive_group));
+            return uint64_t{ 1 } << group_index;
         }
 
-        hive_group_ptr create_new_group(size_t capacity, size_t first_global_index)
+        // first index of group k is initial_capacity * (r^k - 1) / (r - 1) with r = 2^growth_shift
+        size_t get_group_index(size_t global_index) const noexcept
         {
-            auto* ptr = hive_group_allocator{}.allocate(1);
-            new (ptr) hive_group_type{ capacity, first_global_index };
-            hive_group_ptr result{ ptr };
-            return result;
+            auto const ratio_minus_one = (size_t{ 1 } << growth_shift_) - 1;
+            auto const initial_capacity_mask = (size_t{ 1 } << initial_capacity_shift_) - 1;
+            auto const scaled = (global_index >> initial_capacity_shift_) * ratio_minus_one
+                + ((global_index & initial_capacity_mask) * ratio_minus_one >> initial_capacity_shift_);
+            return static_cast<size_t>(std::bit_width(scaled + 1) - 1) / growth_shift_;
         }
 
-        auto get_hive_group(size_t global_index) const
+        size_t get_group_capacity(size_t group_index) const noexcept
         {
-            auto const hive_group_q = global_index / initial_capacity;
-            auto const hive_group_r = global_index % initial_capacity;
-            auto const index_of_group = static_cast<size_t>(std::bit_width(hive_group_q)) - 1;
-            if(index_of_group >= hive_groups_.size())
+            return size_t{ 1 } << (initial_capacity_shift_ + growth_shift_ * group_index);
+        }
+
+        size_t get_group_first_global_index(size_t group_index) const noexcept
+        {
+            auto const ratio_minus_one = (size_t{ 1 } << growth_shift_) - 1;
+            return ((size_t{ 1 } << (growth_shift_ * group_index)) - 1) / ratio_minus_one << initial_capacity_shift_;
+        }
+
+        // returns the (group index, index in group) pair, or the end position
+        std::pair<size_t, size_t> find_first_in_groups(size_t group_index) const noexcept
+        {
+            for(; group_index < group_count_; ++group_index)
+            {
+                auto const* hive_group = hive_groups_[group_index];
+                if(hive_group && !hive_group->empty())
+                {
+                    return { group_index, hive_group->find_allocated(0) };
+                }
+            }
+            return { group_count_, 0 };
+        }
+
+        hive_group_type& get_or_create_group(size_t group_index)
+        {
+            assert(group_index <= max_group_index_);
+            auto& hive_group = hive_groups_[group_index];
+            if(!hive_group)
             {
-                return hive_groups_.cend();
+                hive_group = hive_group_type::create(get_group_capacity(group_index), get_group_first_global_index(group_index));
+                group_count_ = (std::max)(group_count_, group_index + 1);
+            }
+            return *hive_group;
+        }
+
+        void on_element_destructed(size_t group_index) noexcept
+        {
+            available_groups_ |= group_bit(group_index);
+
+            // release the empty group back to the allocator, the first group is kept to avoid thrashing on a small hive
+            if(group_index > 0)
+            {
+                release_group_if_empty(group_index);
+            }
+        }
+
+        void release_group_if_empty(size_t group_index) noexcept
+        {
+            auto& hive_group = hive_groups_[group_index];
+            if(hive_group && hive_group->empty())
+            {
+                hive_group_type::destroy(std::exchange(hive_group, nullptr));
+            }
+        }
+
+        void release_groups() noexcept
+        {
+            for(size_t group_index = 0; group_index < group_count_; ++group_index)
+            {
+                if(auto* hive_group = std::exchange(hive_groups_[group_index], nullptr))
+                {
+                    hive_group_type::destroy(hive_group);
+                }
+            }
+            group_count_ = 0;
+            available_groups_ = all_groups_available();
+        }
+
+        hive_group_type const* get_hive_group(size_t global_index) const noexcept
+        {
+            auto const index_of_group = get_group_index(global_index);
+            if(index_of_group >= group_count_)
+            {
+                return nullptr;
             }
-            auto itr = hive_groups_.cbegin() + index_of_group;
-            assert(*itr);
-            assert(global_index >= itr->get_first_global_index());
-            auto const index_in_group = global_index - itr->get_first_global_index();
-            assert(index_in_group < itr->capacity());
-            return itr;
+            auto const* hive_group = hive_groups_[index_of_group];
+            assert(!hive_group || global_index - hive_group->get_first_global_index() < hive_group->capacity());
+            return hive_group;
         }
 
-        auto get_hive_group(size_t global_index)
+        hive_group_type* get_hive_group(size_t global_index) noexcept
         {
-            auto citr = const_cast<hive*>(this)->get_hive_group(global_index);
-            auto const distance = std::ranges::distance(hive_groups_.cbegin(), citr);
-            return hive_groups_.begin() + distance;
+            return const_cast<hive_group_type*>(const_cast<hive const*>(this)->get_hive_group(global_index));
         }
     };
-}
\ No newline at end of file
+}
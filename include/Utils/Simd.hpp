@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include "Types/Forward.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PUNK_ARCH_X64 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// function attributes to compile a kernel for an instruction set the whole target is not compiled for,
+// the kernel must only be called after checking get_cpu_features()
+#if defined(PUNK_ARCH_X64) && (defined(__GNUC__) || defined(__clang__))
+#define PUNK_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#define PUNK_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx2,bmi,bmi2,popcnt")))
+#else
+#define PUNK_TARGET_AVX2
+#define PUNK_TARGET_AVX512
+#endif
+
+// the widest vector register the kernels are compiled for, in bytes
+#ifndef PUNK_SIMD_WIDTH
+#if defined(__AVX512F__)
+#define PUNK_SIMD_WIDTH 64
+#elif defined(__AVX2__) || defined(__AVX__)
+#define PUNK_SIMD_WIDTH 32
+#else
+#define PUNK_SIMD_WIDTH 16
+#endif
+#endif
+
+namespace punk
+{
+    inline constexpr uint32_t simd_width = PUNK_SIMD_WIDTH;
+    static_assert(std::has_single_bit(simd_width));
+
+    // lane count of a lane-blocked(AoSoA) component, 4 for SSE, 8 for AVX2, 16 for AVX-512 with 32-bit fields
+    inline constexpr uint32_t min_simd_lane_width = 4;
+
+    // select the lane width for the narrowest field, so that one block of that field fills exactly whole vector registers,
+    // the field sizes are powers of two, so the block of every field starts at a multiple of simd_width in the column
+    constexpr uint32_t select_simd_lane_width(uint32_t min_field_size) noexcept
+    {
+        if(min_field_size == 0)
+        {
+            return 1;
+        }
+        auto const lane_width = std::bit_floor((std::max)(simd_width / min_field_size, 1u));
+        return (std::max)(lane_width, min_simd_lane_width);
+    }
+}
+
+// runtime cpu feature detection
+namespace punk
+{
+    struct cpu_features
+    {
+        bool avx2;
+        bool avx512;        // avx512 f + bw + vl
+    };
+
+    inline cpu_features detect_cpu_features() noexcept
+    {
+        cpu_features features{ .avx2 = false, .avx512 = false };
+#if defined(PUNK_ARCH_X64) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        features.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+        features.avx512 = features.avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+#elif defined(PUNK_ARCH_X64) && defined(_MSC_VER)
+        int regs[4]{};
+        __cpuid(regs, 1);
+        bool const os_xsave = (regs[2] & (1 << 27)) != 0;
+        bool const popcnt = (regs[2] & (1 << 23)) != 0;
+        if(os_xsave)
+        {
+            auto const xcr0 = _xgetbv(0);
+            bool const ymm_enabled = (xcr0 & 0x06) == 0x06;
+            bool const zmm_enabled = (xcr0 & 0xe6) == 0xe6;
+            __cpuidex(regs, 7, 0);
+            bool const avx2 = (regs[1] & (1 << 5)) != 0;
+            bool const bmi2 = (regs[1] & (1 << 8)) != 0;
+            bool const avx512f = (regs[1] & (1 << 16)) != 0;
+            bool const avx512bw = (regs[1] & (1 << 30)) != 0;
+            bool const avx512vl = (regs[1] & (1 << 31)) != 0;
+            features.avx2 = ymm_enabled && avx2 && bmi2 && popcnt;
+            features.avx512 = features.avx2 && zmm_enabled && avx512f && avx512bw && avx512vl;
+        }
+#endif
+        return features;
+    }
+
+    inline cpu_features const& get_cpu_features() noexcept
+    {
+        static cpu_features const features = detect_cpu_features();
+        return features;
+    }
+}
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <type_traits>
-#include "async_simple/coro/Lazy.h"
+#include "Task/Lazy.h"
 
 namespace punk
 {
@@ -17,7 +17,7 @@ namespace punk
     }
 
     template <size_t I, size_t N, typename F>
-    auto async_static_for(F&& f) -> async_simple::coro::Lazy<>
+    auto async_static_for(F&& f) -> Lazy<>
     {
         static_assert(I <= N);
         if constexpr (I < N)
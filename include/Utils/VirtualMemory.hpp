@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Types/Forward.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// reserve address space up front, and commit physical memory page by page on demand
+namespace punk
+{
+    inline size_t get_virtual_page_size() noexcept
+    {
+#if defined(_WIN32)
+        static size_t const page_size = []
+            {
+                SYSTEM_INFO info{};
+                GetSystemInfo(&info);
+                return static_cast<size_t>(info.dwPageSize);
+            }();
+#else
+        static size_t const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        return page_size;
+    }
+
+    // reserve address space without backing memory, any access before commit faults
+    inline void* reserve_virtual_memory(size_t size) noexcept
+    {
+#if defined(_WIN32)
+        return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+        void* ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+#endif
+    }
+
+    // commit a page aligned range of reserved memory, the committed memory is zero filled
+    inline bool commit_virtual_memory(void* ptr, size_t size) noexcept
+    {
+#if defined(_WIN32)
+        return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+        // map over the reserved range, so that the pages are accounted as committed
+        void* result = mmap(ptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        return result != MAP_FAILED;
+#endif
+    }
+
+    // commit a page aligned range of reserved memory, with its physical pages preferably placed on the numa node
+    inline bool commit_virtual_memory_on_numa_node(void* ptr, size_t size, uint32_t numa_node) noexcept
+    {
+#if defined(_WIN32)
+        return VirtualAllocExNuma(GetCurrentProcess(), ptr, size, MEM_COMMIT, PAGE_READWRITE, static_cast<DWORD>(numa_node)) != nullptr;
+#else
+        if(!commit_virtual_memory(ptr, size))
+        {
+            return false;
+        }
+#if defined(__linux__) && defined(SYS_mbind)
+        // the pages are not touched yet, so the policy decides where they are placed, MPOL_PREFERRED = 1
+        constexpr int mpol_preferred = 1;
+        constexpr size_t bits_per_mask = sizeof(unsigned long) * 8;
+        unsigned long node_mask[1024 / bits_per_mask]{};
+        if(numa_node < 1024)
+        {
+            node_mask[numa_node / bits_per_mask] = 1ul << (numa_node % bits_per_mask);
+            syscall(SYS_mbind, ptr, size, mpol_preferred, node_mask, size_t{ 1024 }, 0u);
+        }
+#endif
+        return true;
+#endif
+    }
+
+    // return the physical memory of a committed range to the os, the range stays reserved
+    inline void decommit_virtual_memory(void* ptr, size_t size) noexcept
+    {
+#if defined(_WIN32)
+        VirtualFree(ptr, size, MEM_DECOMMIT);
+#else
+        madvise(ptr, size, MADV_DONTNEED);
+        mprotect(ptr, size, PROT_NONE);
+#endif
+    }
+
+    inline void release_virtual_memory(void* ptr, size_t size) noexcept
+    {
+#if defined(_WIN32)
+        (void)size;
+        VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+        munmap(ptr, size);
+#endif
+    }
+}
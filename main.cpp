@@ -5,6 +5,7 @@
 
 #include "Utils/StaticReflection.hpp"
 #include "Types/RTTI.h"
+#include "Task/WorkStealingExecutor.h"
 
 class foo {};
 
@@ -30,8 +31,8 @@ struct alignas(8) test_align
     std::string str_value;
 };
 
-async_simple::coro::Lazy<int> get_43() {
-    std::cout << "run with ::operator new/delete" << '\n';
+punk::Lazy<int> get_43() {
+    std::cout << "run with the coroutine frame pool" << '\n';
     co_return 43;
 }
 
@@ -48,7 +49,8 @@ int main(void)
     std::cout << punk::get_demangle_name<foo>() << std::endl;
     std::cout << punk::get_demangle_name<fee>() << std::endl;
 
-    syncAwait(get_43());
+    std::unique_ptr<punk::work_stealing_executor> executor{ punk::work_stealing_executor::create_instance() };
+    syncAwait(get_43().via(executor.get()));
 
 
     static_assert(boost::pfr::tuple_size_v<bar> == 1);
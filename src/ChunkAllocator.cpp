@@ -0,0 +1,116 @@
+#include "Types/ChunkAllocator.h"
+#include "Task/AdaptiveLock.h"
+#include "CoreTypes.h"
+#include "Utils/VirtualMemory.hpp"
+
+namespace punk
+{
+    class chunk_allocator_impl final : public chunk_allocator
+    {
+    private:
+        static constexpr size_t block_size = chunk_memory_size * chunks_per_block;
+
+        uint8_t*                base_;
+        size_t const            max_block_count_;
+        uint32_t const          numa_node_;
+
+        mutable adaptive_lock   lock_;
+        size_t                  committed_block_count_ = 0;
+        std::vector<chunk_t*>   free_chunks_;
+        size_t                  allocated_count_ = 0;
+
+    public:
+        chunk_allocator_impl(uint32_t numa_node, size_t max_chunk_count)
+            : max_block_count_((std::max)((max_chunk_count + chunks_per_block - 1) / chunks_per_block, size_t{ 1 }))
+            , numa_node_(numa_node)
+        {
+            static_assert(chunk_memory_size % 4096 == 0, "chunks are made of whole pages");
+            base_ = static_cast<uint8_t*>(reserve_virtual_memory(max_block_count_ * block_size));
+        }
+
+        virtual ~chunk_allocator_impl()
+        {
+            if(base_)
+            {
+                release_virtual_memory(base_, max_block_count_ * block_size);
+            }
+        }
+
+        virtual chunk_t* allocate_chunk() override
+        {
+            std::lock_guard lock{ lock_ };
+            if(free_chunks_.empty() && !commit_block())
+            {
+                return nullptr;
+            }
+
+            auto* chunk = free_chunks_.back();
+            free_chunks_.pop_back();
+            ++allocated_count_;
+            return chunk;
+        }
+
+        virtual void deallocate_chunk(chunk_t* chunk) override
+        {
+            if(!chunk)
+            {
+                return;
+            }
+
+            // the pages stay committed & placed on the node, only the contents are reset for the next owner
+            std::memset(chunk, 0, chunk_memory_size);
+            std::lock_guard lock{ lock_ };
+            assert(reinterpret_cast<uint8_t*>(chunk) >= base_ && reinterpret_cast<uint8_t*>(chunk) < base_ + committed_block_count_ * block_size);
+            free_chunks_.push_back(chunk);
+            --allocated_count_;
+        }
+
+        virtual uint32_t get_numa_node() const override
+        {
+            return numa_node_;
+        }
+
+        virtual size_t get_allocated_chunk_count() const override
+        {
+            std::lock_guard lock{ lock_ };
+            return allocated_count_;
+        }
+
+        virtual size_t get_committed_chunk_count() const override
+        {
+            std::lock_guard lock{ lock_ };
+            return committed_block_count_ * chunks_per_block;
+        }
+
+    private:
+        bool commit_block()
+        {
+            if(!base_ || committed_block_count_ >= max_block_count_)
+            {
+                return false;
+            }
+
+            auto* block = base_ + committed_block_count_ * block_size;
+            auto const committed = numa_node_ != invalid_index_value() ?
+                commit_virtual_memory_on_numa_node(block, block_size, numa_node_) :
+                commit_virtual_memory(block, block_size);
+            if(!committed)
+            {
+                return false;
+            }
+            ++committed_block_count_;
+
+            // handed out from the lowest address up
+            for(uint32_t loop = chunks_per_block; loop > 0; --loop)
+            {
+                free_chunks_.push_back(reinterpret_cast<chunk_t*>(block + (loop - 1) * chunk_memory_size));
+            }
+            return true;
+        }
+    };
+
+    chunk_allocator* chunk_allocator::create_instance(uint32_t numa_node, size_t max_chunk_count)
+    {
+        return new chunk_allocator_impl{ numa_node, max_chunk_count };
+    }
+}
@@ -1,14 +1,17 @@
 #pragma once
 
+#include "Types/StaticArchetype.hpp"
+
 namespace punk
 {
     struct chunk_t
     {
-        static constexpr size_t chunke_size = 16 * 1024;
+        static constexpr size_t chunke_size = chunk_memory_size;
 
         uint32_t                    element_count;
         uint32_t                    chunk_number;
     };
+    static_assert(sizeof(chunk_t) == chunk_header_size);
 
     // data index in one chunk
     using chunk_index_t = handle<chunk_t, uint32_t>;
@@ -31,6 +34,8 @@ namespace punk
         // TODO ... using C++ attributes to manager these two
         component_tag_t             component_tag;
         uint32_t                    component_group;
+        bool                        arithmetic;
+        bool                        lane_blocked;           // opted in to the lane-blocked layout
     };
 
     struct component_info_t
@@ -39,6 +44,7 @@ namespace punk
         uint32_t                    index_in_group;
         uint32_t                    index_of_group;
         uint32_t                    offset_in_chunk;
+        uint32_t                    lane_width;             // 1 for plain array layout, otherwise elements are lane-blocked(AoSoA)
     };
 
     struct component_group_info_t
@@ -51,13 +57,34 @@ namespace punk
 
     struct archetype_t
     {
-        uint32_t                        hash;
+        uint64_t                        hash;
+        uint32_t                        lane_width;             // SIMD lane width chosen for the lane-blocked components
         bool                            registered;
         vector<type_info_t const*>      component_types;
         vector<component_info_t>        component_infos;
         vector<component_group_info_t>  component_groups;
     };
 
+    // a component is lane-blocked when it opts in with lane_blocked_layout_tag and all of its fields are arithmetic,
+    // then each block of lane_width elements stores field by field: [x0..xN-1][y0..yN-1]...
+    inline bool is_component_lane_blockable(type_info_t const* component_type)
+    {
+        return component_type->lane_blocked && !component_type->fields.empty() && std::ranges::all_of(component_type->fields,
+            [](field_info_t const& field)
+            {
+                return field.type && field.type->arithmetic;
+            });
+    }
+
+    // address of a field of the element at index_in_chunk, for both the plain and lane-blocked layout
+    inline void* get_component_field_address(chunk_t* chunk, type_info_t const* component_type,
+        component_info_t const& component_info, uint32_t index_in_chunk, uint32_t field_index)
+    {
+        auto const& field = component_type->fields[field_index];
+        auto* column = reinterpret_cast<uint8_t*>(chunk) + component_info.offset_in_chunk;
+        return column + get_column_field_offset(index_in_chunk, component_type->size, component_info.lane_width, field.offset, field.type->size);
+    }
+
     using archetype_delete_delegate_t = std::function<void(archetype_t*)>;
     using component_index_t = handle<component_info_t, uint16_t>;
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "Task/Lazy.h"
+
+namespace punk
+{
+    // frames of bucket i are (min_pooled_frame_size << i) bytes
+    inline constexpr size_t frame_bucket_count = std::bit_width(max_pooled_frame_size / min_pooled_frame_size);
+    inline constexpr uint32_t max_cached_frames_per_bucket = 1024;
+
+    inline size_t get_frame_bucket_index(size_t size) noexcept
+    {
+        return size <= min_pooled_frame_size ? 0 : std::bit_width((size - 1) / min_pooled_frame_size);
+    }
+
+    struct free_frame_node
+    {
+        free_frame_node* next;
+    };
+
+    // trivially destructible, so frames freed during the thread exit can still see it
+    struct coroutine_frame_cache
+    {
+        std::array<free_frame_node*, frame_bucket_count>    free_lists;
+        std::array<uint32_t, frame_bucket_count>            cached_counts;
+        bool                                                released;
+    };
+    thread_local constinit coroutine_frame_cache frame_cache{};
+
+    // returns the cached frames to the global heap at the thread exit
+    struct coroutine_frame_cache_releaser
+    {
+        ~coroutine_frame_cache_releaser()
+        {
+            for(size_t bucket_index = 0; bucket_index < frame_bucket_count; ++bucket_index)
+            {
+                while(auto* node = frame_cache.free_lists[bucket_index])
+                {
+                    frame_cache.free_lists[bucket_index] = node->next;
+                    ::operator delete(node, min_pooled_frame_size << bucket_index);
+                }
+                frame_cache.cached_counts[bucket_index] = 0;
+            }
+            frame_cache.released = true;
+        }
+    };
+    thread_local coroutine_frame_cache_releaser frame_cache_releaser;
+
+    void* allocate_coroutine_frame(size_t size)
+    {
+        if(size > max_pooled_frame_size)
+        {
+            return ::operator new(size);
+        }
+
+        auto const bucket_index = get_frame_bucket_index(size);
+        if(auto* node = frame_cache.free_lists[bucket_index])
+        {
+            frame_cache.free_lists[bucket_index] = node->next;
+            --frame_cache.cached_counts[bucket_index];
+            return node;
+        }
+        return ::operator new(min_pooled_frame_size << bucket_index);
+    }
+
+    void deallocate_coroutine_frame(void* frame, size_t size) noexcept
+    {
+        if(size > max_pooled_frame_size)
+        {
+            ::operator delete(frame, size);
+            return;
+        }
+
+        auto const bucket_index = get_frame_bucket_index(size);
+        if(frame_cache.released || frame_cache.cached_counts[bucket_index] >= max_cached_frames_per_bucket)
+        {
+            ::operator delete(frame, min_pooled_frame_size << bucket_index);
+            return;
+        }
+
+        // odr-use the releaser, so it is constructed on this thread before any frame is cached
+        static_cast<void>(&frame_cache_releaser);
+        frame_cache.free_lists[bucket_index] = new(frame) free_frame_node{ frame_cache.free_lists[bucket_index] };
+        ++frame_cache.cached_counts[bucket_index];
+    }
+}
@@ -0,0 +1,258 @@
+#include "Types/Delta.h"
+#include "CoreTypes.h"
+#include "Utils/Hash.hpp"
+
+namespace punk
+{
+    // a leaf field of the flattened type, the offset is relative to the element
+    struct delta_leaf_field
+    {
+        uint32_t    offset;
+        uint32_t    size;
+        bool        arithmetic;
+    };
+
+    inline void append_delta_varint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    inline bool read_delta_varint(std::span<uint8_t const> data, size_t& position, uint64_t& value)
+    {
+        value = 0;
+        for(uint32_t shift = 0; shift < 64; shift += 7)
+        {
+            if(position >= data.size())
+            {
+                return false;
+            }
+            auto const byte = data[position++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline uint64_t load_delta_leaf(uint8_t const* address, uint32_t size)
+    {
+        uint64_t value = 0;
+        std::memcpy(&value, address, size);
+        return value;
+    }
+
+    class delta_codec_impl final : public delta_codec
+    {
+    private:
+        type_info_t const*              type_info_;
+        std::vector<delta_leaf_field>   leaves_;
+        uint32_t                        mask_size_;
+
+    public:
+        explicit delta_codec_impl(type_info_t const* type_info)
+            : type_info_(type_info)
+        {
+            flatten(type_info, 0);
+            mask_size_ = static_cast<uint32_t>((leaves_.size() + 7) / 8);
+        }
+
+        virtual type_info_t const* get_type_info() const override
+        {
+            return type_info_;
+        }
+
+        virtual uint32_t get_leaf_field_count() const override
+        {
+            return static_cast<uint32_t>(leaves_.size());
+        }
+
+        virtual bool encode(void const* baseline, void const* current, std::vector<uint8_t>& out) const override
+        {
+            return encode_element(static_cast<uint8_t const*>(baseline), static_cast<uint8_t const*>(current), 0, 1, out, true);
+        }
+
+        virtual error_code decode(void const* baseline, void* result, std::span<uint8_t const> data, size_t& consumed) const override
+        {
+            if(result != baseline)
+            {
+                std::memcpy(result, baseline, type_info_->size);
+            }
+
+            consumed = 0;
+            return apply_element(static_cast<uint8_t const*>(baseline), static_cast<uint8_t*>(result), 0, 1, data, consumed) ?
+                error_code::succeed : error_code::delta_corrupted;
+        }
+
+        virtual bool encode_column(void const* baseline, void const* current, uint32_t element_count, uint32_t lane_width, std::vector<uint8_t>& out) const override
+        {
+            auto const mask_position = out.size();
+            out.resize(mask_position + (element_count + 7) / 8, 0);
+
+            // unchanged elements only cost their bit in the element mask
+            bool changed = false;
+            for(uint32_t index = 0; index < element_count; ++index)
+            {
+                if(encode_element(static_cast<uint8_t const*>(baseline), static_cast<uint8_t const*>(current), index, lane_width, out, false))
+                {
+                    out[mask_position + index / 8] |= static_cast<uint8_t>(1u << (index % 8));
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        virtual error_code decode_column(void const* baseline, void* result, uint32_t element_count, uint32_t lane_width,
+            std::span<uint8_t const> data, size_t& consumed) const override
+        {
+            if(result != baseline)
+            {
+                // lane-blocked columns hold whole blocks
+                auto const count = lane_width > 1 ? align_up(element_count, lane_width) : element_count;
+                std::memcpy(result, baseline, size_t{ count } * type_info_->size);
+            }
+
+            consumed = 0;
+            auto const element_mask_size = (element_count + 7) / 8;
+            if(data.size() < element_mask_size)
+            {
+                return error_code::delta_corrupted;
+            }
+            auto const* element_mask = data.data();
+            consumed = element_mask_size;
+
+            for(uint32_t index = 0; index < element_count; ++index)
+            {
+                if((element_mask[index / 8] >> (index % 8)) & 1)
+                {
+                    if(!apply_element(static_cast<uint8_t const*>(baseline), static_cast<uint8_t*>(result), index, lane_width, data, consumed))
+                    {
+                        return error_code::delta_corrupted;
+                    }
+                }
+            }
+            return error_code::succeed;
+        }
+
+    private:
+        // nested fields are flattened, the padding between fields is never encoded
+        void flatten(type_info_t const* type_info, uint32_t offset)
+        {
+            if(!type_info->fields.empty())
+            {
+                for(auto const& field : type_info->fields)
+                {
+                    flatten(field.type, offset + field.offset);
+                }
+            }
+            else if(type_info->size > 0)
+            {
+                leaves_.push_back(delta_leaf_field
+                {
+                    .offset = offset,
+                    .size = type_info->size,
+                    .arithmetic = type_info->arithmetic && type_info->size <= sizeof(uint64_t),
+                });
+            }
+        }
+
+        // lane-blocked components only have arithmetic fields, so their leaves are their fields
+        size_t get_leaf_offset(delta_leaf_field const& leaf, uint32_t index, uint32_t lane_width) const
+        {
+            return get_column_field_offset(index, type_info_->size, lane_width, leaf.offset, leaf.size);
+        }
+
+        bool encode_element(uint8_t const* baseline, uint8_t const* current, uint32_t index, uint32_t lane_width,
+            std::vector<uint8_t>& out, bool keep_unchanged) const
+        {
+            auto const mask_position = out.size();
+            out.resize(mask_position + mask_size_, 0);
+
+            bool changed = false;
+            for(size_t leaf_index = 0; leaf_index < leaves_.size(); ++leaf_index)
+            {
+                auto const& leaf = leaves_[leaf_index];
+                auto const offset = get_leaf_offset(leaf, index, lane_width);
+                if(std::memcmp(baseline + offset, current + offset, leaf.size) == 0)
+                {
+                    continue;
+                }
+
+                out[mask_position + leaf_index / 8] |= static_cast<uint8_t>(1u << (leaf_index % 8));
+                changed = true;
+                if(leaf.arithmetic)
+                {
+                    append_delta_varint(out, load_delta_leaf(baseline + offset, leaf.size) ^ load_delta_leaf(current + offset, leaf.size));
+                }
+                else
+                {
+                    out.insert(out.end(), current + offset, current + offset + leaf.size);
+                }
+            }
+
+            if(!changed && !keep_unchanged)
+            {
+                out.resize(mask_position);
+            }
+            return changed;
+        }
+
+        bool apply_element(uint8_t const* baseline, uint8_t* result, uint32_t index, uint32_t lane_width,
+            std::span<uint8_t const> data, size_t& position) const
+        {
+            if(data.size() - position < mask_size_)
+            {
+                return false;
+            }
+            auto const* mask = data.data() + position;
+            position += mask_size_;
+
+            for(size_t leaf_index = 0; leaf_index < leaves_.size(); ++leaf_index)
+            {
+                if(((mask[leaf_index / 8] >> (leaf_index % 8)) & 1) == 0)
+                {
+                    continue;
+                }
+
+                auto const& leaf = leaves_[leaf_index];
+                auto const offset = get_leaf_offset(leaf, index, lane_width);
+                if(leaf.arithmetic)
+                {
+                    uint64_t difference;
+                    if(!read_delta_varint(data, position, difference) ||
+                        (leaf.size < sizeof(uint64_t) && (difference >> (leaf.size * 8)) != 0))
+                    {
+                        return false;
+                    }
+                    auto const value = load_delta_leaf(baseline + offset, leaf.size) ^ difference;
+                    std::memcpy(result + offset, &value, leaf.size);
+                }
+                else
+                {
+                    if(data.size() - position < leaf.size)
+                    {
+                        return false;
+                    }
+                    std::memcpy(result + offset, data.data() + position, leaf.size);
+                    position += leaf.size;
+                }
+            }
+            return true;
+        }
+    };
+
+    delta_codec* delta_codec::create_instance(type_info_t const* type_info)
+    {
+        if(!type_info || type_info->size == 0 || type_info->vtable.copy_func || type_info->vtable.destructor)
+        {
+            return nullptr;
+        }
+        return new delta_codec_impl{ type_info };
+    }
+}
@@ -1,34 +1,646 @@
 #include "Types/EntityPool.h"
+#include "Utils/Hash.hpp"
 #include "Utils/Hive.hpp"
+#include "Utils/Simd.hpp"
+#include "Utils/VirtualMemory.hpp"
+#include <atomic>
 
 namespace punk
 {
+    using entity_tag = entity_t::entity_tag;
+    using entity_version = entity_t::entity_version;
+
+    // the tag & version of the slot, with the same layout as the upper half of entity_t
+    struct entity_slot
+    {
+        entity_tag      tag;
+        entity_version  version;
+        uint32_t        next_free;      // next slot in the free list, or alive_slot_mark when allocated
+    };
+    static_assert(sizeof(entity_slot) == sizeof(uint64_t));
+
+    constexpr entity_location_t invalid_entity_location() noexcept
+    {
+        return { .archetype = nullptr, .chunk = nullptr, .index_in_chunk = invalid_index_value() };
+    }
+
+    // entity -> location map in fixed-size pages, the address space of all pages is reserved up front,
+    // a page is committed when the first entity in it becomes alive and decommitted when the last one dies
+    class entity_location_table
+    {
+    public:
+        static constexpr uint32_t page_entity_count = 4096;
+
+    private:
+        uint8_t*                base_ = nullptr;
+        size_t                  page_stride_ = 0;
+        uint32_t const          max_entity_count_;
+        // alive entities per page, a page is committed iff its count is not zero
+        std::vector<uint32_t>   page_live_counts_;
+
+    public:
+        explicit entity_location_table(uint32_t max_entity_count)
+            : max_entity_count_(max_entity_count) {}
+
+        ~entity_location_table()
+        {
+            release();
+        }
+
+        entity_location_table(entity_location_table const&) = delete;
+        entity_location_table& operator=(entity_location_table const&) = delete;
+
+        // the entity at index becomes alive
+        void acquire(uint32_t index)
+        {
+            assert(index < max_entity_count_);
+            auto const page_index = index / page_entity_count;
+            if(page_index >= page_live_counts_.size())
+            {
+                page_live_counts_.resize(page_index + 1, 0);
+            }
+            if(page_live_counts_[page_index]++ == 0)
+            {
+                commit_page(page_index);
+            }
+            (*this)[index] = invalid_entity_location();
+        }
+
+        // the entity at index dies
+        void release(uint32_t index) noexcept
+        {
+            auto const page_index = index / page_entity_count;
+            assert(page_index < page_live_counts_.size() && page_live_counts_[page_index] > 0);
+            if(--page_live_counts_[page_index] == 0)
+            {
+                decommit_virtual_memory(get_page(page_index), page_stride_);
+            }
+        }
+
+        // release all the pages and the reserved address space
+        void release() noexcept
+        {
+            if(base_)
+            {
+                release_virtual_memory(base_, get_reserved_size());
+                base_ = nullptr;
+            }
+            std::vector<uint32_t>{}.swap(page_live_counts_);
+        }
+
+        // only valid for alive entities
+        entity_location_t& operator[](uint32_t index) noexcept
+        {
+            assert(index / page_entity_count < page_live_counts_.size() && page_live_counts_[index / page_entity_count] > 0);
+            return get_page(index / page_entity_count)[index % page_entity_count];
+        }
+
+        entity_location_t const& operator[](uint32_t index) const noexcept
+        {
+            return const_cast<entity_location_table&>(*this)[index];
+        }
+
+    private:
+        void commit_page(uint32_t page_index)
+        {
+            // reserve the address space on first use, id spaces of unused tags cost nothing
+            if(!base_)
+            {
+                page_stride_ = align_up(page_entity_count * sizeof(entity_location_t), get_virtual_page_size());
+                base_ = static_cast<uint8_t*>(reserve_virtual_memory(get_reserved_size()));
+                if(!base_)
+                {
+                    throw std::bad_alloc{};
+                }
+            }
+            if(!commit_virtual_memory(get_page(page_index), page_stride_))
+            {
+                page_live_counts_[page_index]--;
+                throw std::bad_alloc{};
+            }
+        }
+
+        entity_location_t* get_page(uint32_t page_index) const noexcept
+        {
+            return reinterpret_cast<entity_location_t*>(base_ + page_index * page_stride_);
+        }
+
+        size_t get_reserved_size() const noexcept
+        {
+            auto const page_count = (size_t{ max_entity_count_ } + page_entity_count - 1) / page_entity_count;
+            return page_count * page_stride_;
+        }
+    };
+
+    // the id space of one entity tag
+    class entity_id_space
+    {
+    public:
+        static constexpr uint32_t invalid_slot_index = entity_handle::invalid_handle_value();
+        static constexpr uint32_t alive_slot_mark = invalid_slot_index - 1;
+
+    private:
+        std::vector<entity_slot>        slots_;
+        entity_location_table           locations_;
+        uint32_t                        free_head_ = invalid_slot_index;
+        // high-water mark of handed out handles, slots_ only covers it after reservations are committed
+        std::atomic<uint32_t>           fresh_index_ = 0;
+        uint32_t const                  max_entity_count_;
+        entity_tag const                tag_;
+        // version of fresh slots, moves past all the versions ever used when the space is released
+        entity_version                  initial_version_ = 0;
+        entity_version                  max_version_ = 0;
+
+    public:
+        entity_id_space(entity_tag tag, uint32_t max_entity_count)
+            : locations_(max_entity_count)
+            , max_entity_count_(max_entity_count)
+            , tag_(tag) {}
+
+        entity_t allocate()
+        {
+            uint32_t index = free_head_;
+            if(index != invalid_slot_index)
+            {
+                // recycle the head of the free list, the version has been bumped when freed
+                locations_.acquire(index);
+                free_head_ = slots_[index].next_free;
+            }
+            else
+            {
+                // no free slot, take a fresh one
+                auto const [first_index, count] = take_fresh_indices(1);
+                if(count == 0)
+                {
+                    return entity_t::invalid_entity();
+                }
+                index = first_index;
+                grow_slots(index + 1);
+                locations_.acquire(index);
+            }
+
+            auto& slot = slots_[index];
+            slot.next_free = alive_slot_mark;
+            return entity_t::compose(entity_handle{ index }, tag_, slot.version);
+        }
+
+        size_t allocate(std::span<entity_t> entities)
+        {
+            size_t count = 0;
+
+            // recycle the free list first
+            for(; count < entities.size() && free_head_ != invalid_slot_index; ++count)
+            {
+                auto const index = free_head_;
+                locations_.acquire(index);
+                auto& slot = slots_[index];
+                free_head_ = slot.next_free;
+                slot.next_free = alive_slot_mark;
+                entities[count] = entity_t::compose(entity_handle{ index }, tag_, slot.version);
+            }
+
+            // then take the rest from fresh handles in one resize
+            auto const [first_index, append_count] = take_fresh_indices(entities.size() - count);
+            grow_slots(first_index + append_count);
+            for(uint32_t loop = 0; loop < append_count; ++loop, ++count)
+            {
+                auto const index = first_index + loop;
+                locations_.acquire(index);
+                slots_[index].next_free = alive_slot_mark;
+                entities[count] = entity_t::compose(entity_handle{ index }, tag_, initial_version_);
+            }
+
+            std::ranges::fill(entities.subspan(count), entity_t::invalid_entity());
+            return count;
+        }
+
+        void deallocate(entity_t entity)
+        {
+            if(!is_alive(entity))
+            {
+                return;
+            }
+
+            // bump the version, so that all the copies of the entity are expired
+            auto const index = entity.get_handle().get_value();
+            auto& slot = slots_[index];
+            slot.version++;
+            max_version_ = (std::max)(max_version_, slot.version);
+            slot.next_free = free_head_;
+            free_head_ = index;
+            locations_.release(index);
+        }
+
+        bool is_alive(entity_t entity) const
+        {
+            auto const index = entity.get_handle().get_value();
+            if(index >= slots_.size())
+            {
+                return false;
+            }
+            auto const& slot = slots_[index];
+            return slot.next_free == alive_slot_mark && slot.version == entity.get_version();
+        }
+
+        entity_t restore(entity_handle handle) const
+        {
+            auto const index = handle.get_value();
+            if(index >= slots_.size() || slots_[index].next_free != alive_slot_mark)
+            {
+                return entity_t::invalid_entity();
+            }
+            return entity_t::compose(handle, tag_, slots_[index].version);
+        }
+
+        entity_reservation reserve(uint32_t count)
+        {
+            auto const [first_index, reserved_count] = take_fresh_indices(count);
+            return entity_reservation{ first_index, reserved_count, tag_, initial_version_ };
+        }
+
+        void commit(entity_reservation const& reservation)
+        {
+            auto const first_index = reservation.get_first_index();
+            auto const used_end = first_index + reservation.get_used_count();
+            auto const end = first_index + reservation.get_count();
+            if(reservation.get_count() == 0)
+            {
+                return;
+            }
+            assert(reservation.get_version() == initial_version_);
+            assert(end <= fresh_index_.load(std::memory_order_relaxed));
+            grow_slots(end);
+
+            // minted entities become alive
+            for(uint32_t index = first_index; index < used_end; ++index)
+            {
+                locations_.acquire(index);
+                slots_[index].next_free = alive_slot_mark;
+            }
+
+            // return the unused handles to the free list
+            for(uint32_t index = end; index > used_end; --index)
+            {
+                slots_[index - 1].next_free = free_head_;
+                free_head_ = index - 1;
+            }
+        }
+
+        // drop all the slots & location pages, without visiting them one by one
+        void release()
+        {
+            std::vector<entity_slot>{}.swap(slots_);
+            locations_.release();
+            free_head_ = invalid_slot_index;
+            fresh_index_.store(0, std::memory_order_relaxed);
+
+            // the 16 bits version wraps like the per-slot version does
+            max_version_++;
+            initial_version_ = max_version_;
+        }
+
+        entity_location_t const* get_location(entity_t entity) const
+        {
+            if(!is_alive(entity))
+            {
+                return nullptr;
+            }
+            return &locations_[entity.get_handle().get_value()];
+        }
+
+        error_code set_location(entity_t entity, entity_location_t const& location)
+        {
+            if(!is_alive(entity))
+            {
+                return error_code::entity_expired;
+            }
+            locations_[entity.get_handle().get_value()] = location;
+            return error_code::succeed;
+        }
+
+        entity_slot const* get_slots() const noexcept
+        {
+            return slots_.data();
+        }
+
+        size_t get_slot_count() const noexcept
+        {
+            return slots_.size();
+        }
+
+    private:
+        // atomically take up to count fresh handles, returns the first index and the count taken
+        std::pair<uint32_t, uint32_t> take_fresh_indices(size_t count) noexcept
+        {
+            auto current = fresh_index_.load(std::memory_order_relaxed);
+            uint32_t taken;
+            do
+            {
+                taken = static_cast<uint32_t>((std::min)(count, static_cast<size_t>(max_entity_count_ - current)));
+            } while(!fresh_index_.compare_exchange_weak(current, current + taken, std::memory_order_relaxed));
+            return { current, taken };
+        }
+
+        // the slots between the old size and new size may be reserved by other threads, they are not alive until committed
+        void grow_slots(size_t size)
+        {
+            if(size > slots_.size())
+            {
+                slots_.resize(size, { .tag = tag_, .version = initial_version_, .next_free = invalid_slot_index });
+            }
+        }
+    };
+
     class entity_pool_impl : public entity_pool
     {
     public:
+        using are_alive_kernel_t = void(*)(entity_slot const* slots, size_t slot_count,
+            entity_t const* entities, size_t count, uint64_t* result_blocks, size_t first_bit);
+
+        static constexpr uint32_t alive_slot_mark = entity_id_space::alive_slot_mark;
+
+        // two-level directory of id spaces indexed by tag, spaces are created lock-free on first use
+        static constexpr size_t space_page_size = 256;
+        static constexpr size_t space_page_count = (size_t{ (std::numeric_limits<entity_tag>::max)() } + 1) / space_page_size;
+        using space_page = std::array<std::atomic<entity_id_space*>, space_page_size>;
+
+    private:
+        std::array<std::atomic<space_page*>, space_page_count> space_directory_{};
+        are_alive_kernel_t are_alive_kernel_ = select_are_alive_kernel();
+        uint32_t const max_entities_per_tag_;
+
+    public:
+        explicit entity_pool_impl(uint32_t max_entities_per_tag)
+            : max_entities_per_tag_((std::min)(max_entities_per_tag, entity_id_space::alive_slot_mark)) {}
+
+        virtual ~entity_pool_impl() override
+        {
+            for(auto& page_ptr : space_directory_)
+            {
+                auto* page = page_ptr.load(std::memory_order_acquire);
+                if(!page)
+                {
+                    continue;
+                }
+                for(auto& space : *page)
+                {
+                    delete space.load(std::memory_order_acquire);
+                }
+                delete page;
+            }
+        }
+
         virtual entity_t allocate_entity(uint16_t tag) override
         {
-            return entity_t::invalid_entity();
+            return get_or_create_space(tag).allocate();
         }
 
         virtual void deallocate_entity(entity_t entity) override
         {
-            
+            if(auto* space = find_space(entity.get_tag()))
+            {
+                space->deallocate(entity);
+            }
+        }
+
+        virtual bool is_alive(entity_t entity) const override
+        {
+            auto const* space = find_space(entity.get_tag());
+            return space && space->is_alive(entity);
+        }
+
+        virtual entity_t restore_entity(entity_handle handle, uint16_t tag) const override
+        {
+            auto const* space = find_space(tag);
+            return space ? space->restore(handle) : entity_t::invalid_entity();
+        }
+
+        virtual size_t allocate_entities(std::span<entity_t> entities, uint16_t tag) override
+        {
+            return get_or_create_space(tag).allocate(entities);
+        }
+
+        virtual void deallocate_entities(std::span<entity_t const> entities) override
+        {
+            for_each_tag_run(entities, [](entity_id_space* space, std::span<entity_t const> run, size_t)
+                {
+                    if(!space)
+                    {
+                        return;
+                    }
+                    for(auto const entity : run)
+                    {
+                        space->deallocate(entity);
+                    }
+                });
+        }
+
+        virtual void are_alive(std::span<entity_t const> entities, dynamic_bitset<>& result) const override
+        {
+            result.resize(entities.size());
+            result.reset();
+            for_each_tag_run(entities, [this, &result](entity_id_space const* space, std::span<entity_t const> run, size_t first)
+                {
+                    if(space && space->get_slot_count() > 0)
+                    {
+                        are_alive_kernel_(space->get_slots(), space->get_slot_count(), run.data(), run.size(), result.data(), first);
+                    }
+                });
+        }
+
+        virtual entity_reservation reserve_entities(uint32_t count, uint16_t tag) override
+        {
+            return get_or_create_space(tag).reserve(count);
+        }
+
+        virtual void commit_reservation(entity_reservation const& reservation) override
+        {
+            if(auto* space = find_space(reservation.get_tag()))
+            {
+                space->commit(reservation);
+            }
+        }
+
+        virtual void release_tag(uint16_t tag) override
+        {
+            if(auto* space = find_space(tag))
+            {
+                space->release();
+            }
+        }
+
+        virtual entity_location_t const* get_entity_location(entity_t entity) const override
+        {
+            auto const* space = find_space(entity.get_tag());
+            return space ? space->get_location(entity) : nullptr;
+        }
+
+        virtual error_code set_entity_location(entity_t entity, entity_location_t const& location) override
+        {
+            auto* space = find_space(entity.get_tag());
+            return space ? space->set_location(entity, location) : error_code::entity_expired;
+        }
+
+    private:
+        entity_id_space* find_space(entity_tag tag) const noexcept
+        {
+            auto const* page = space_directory_[tag / space_page_size].load(std::memory_order_acquire);
+            return page ? (*page)[tag % space_page_size].load(std::memory_order_acquire) : nullptr;
+        }
+
+        entity_id_space& get_or_create_space(entity_tag tag)
+        {
+            // get or create the page
+            auto& page_ptr = space_directory_[tag / space_page_size];
+            auto* page = page_ptr.load(std::memory_order_acquire);
+            if(!page)
+            {
+                auto new_page = std::make_unique<space_page>();
+                if(page_ptr.compare_exchange_strong(page, new_page.get(), std::memory_order_acq_rel))
+                {
+                    page = new_page.release();
+                }
+            }
+
+            // get or create the space
+            auto& space_ptr = (*page)[tag % space_page_size];
+            auto* space = space_ptr.load(std::memory_order_acquire);
+            if(!space)
+            {
+                auto new_space = std::make_unique<entity_id_space>(tag, max_entities_per_tag_);
+                if(space_ptr.compare_exchange_strong(space, new_space.get(), std::memory_order_acq_rel))
+                {
+                    space = new_space.release();
+                }
+            }
+            return *space;
         }
 
-        virtual void is_alive(entity_t entity) override
+        // visit the runs of entities with the same tag, with the position of the run in the span
+        template <typename F>
+        void for_each_tag_run(std::span<entity_t const> entities, F&& f) const
         {
-            
+            size_t first = 0;
+            while(first < entities.size())
+            {
+                auto const tag = entities[first].get_tag();
+                auto last = first + 1;
+                while(last < entities.size() && entities[last].get_tag() == tag)
+                {
+                    ++last;
+                }
+                f(find_space(tag), entities.subspan(first, last - first), first);
+                first = last;
+            }
         }
 
-        virtual entity_t restore_entity(entity_handle handle) override
+        // the slot value an alive entity must match: tag & version from the upper half of entity, and the alive mark
+        static constexpr uint64_t expected_slot_value(uint64_t entity_value) noexcept
         {
-            return entity_t::invalid_entity();
+            return (entity_value >> 32) | (uint64_t{ alive_slot_mark } << 32);
+        }
+
+        static are_alive_kernel_t select_are_alive_kernel() noexcept
+        {
+#if defined(PUNK_ARCH_X64)
+            if(get_cpu_features().avx2)
+            {
+                return &are_alive_avx2;
+            }
+#endif
+            return &are_alive_scalar;
+        }
+
+        // branch-free compare of one entity, out of range handles read slot 0 and are masked off
+        static uint64_t is_alive_bit(entity_slot const* slots, size_t slot_count, entity_t entity) noexcept
+        {
+            auto const value = entity.get_value();
+            auto const index = static_cast<uint32_t>(value);
+            auto const in_range = index < slot_count;
+            auto const slot_value = std::bit_cast<uint64_t>(slots[in_range ? index : 0]);
+            return static_cast<uint64_t>(in_range & (slot_value == expected_slot_value(value)));
+        }
+
+        // split [first_bit, first_bit + count) of the result into pieces that each fall in one block
+        template <typename F>
+        static void for_each_result_block(size_t count, uint64_t* result_blocks, size_t first_bit, F&& f)
+        {
+            for(size_t first = 0; first < count;)
+            {
+                auto const bit = first_bit + first;
+                auto const end = (std::min)(first + 64 - bit % 64, count);
+                result_blocks[bit / 64] |= f(first, end) << (bit % 64);
+                first = end;
+            }
+        }
+
+        static void are_alive_scalar(entity_slot const* slots, size_t slot_count,
+            entity_t const* entities, size_t count, uint64_t* result_blocks, size_t first_bit)
+        {
+            for_each_result_block(count, result_blocks, first_bit, [=](size_t first, size_t end)
+                {
+                    uint64_t bits = 0;
+                    for(size_t loop = first; loop < end; ++loop)
+                    {
+                        bits |= is_alive_bit(slots, slot_count, entities[loop]) << (loop - first);
+                    }
+                    return bits;
+                });
+        }
+
+#if defined(PUNK_ARCH_X64)
+        // 4 entities per step: gather the 64-bit slots by handle, then compare with (tag, version, alive mark)
+        PUNK_TARGET_AVX2 static uint64_t are_alive_avx2_bits(entity_slot const* slots, size_t slot_count,
+            entity_t const* entities, size_t first, size_t end)
+        {
+            auto const* base = reinterpret_cast<long long const*>(slots);
+            __m256i const handle_lanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+            __m128i const sign_bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+            __m128i const biased_count = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(slot_count))), sign_bias);
+            __m256i const alive_mark = _mm256_set1_epi64x(static_cast<long long>(uint64_t{ alive_slot_mark } << 32));
+
+            uint64_t bits = 0;
+            size_t loop = first;
+            for(; loop + 4 <= end; loop += 4)
+            {
+                __m256i const values = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(entities + loop));
+                __m128i const handles = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(values, handle_lanes));
+                // unsigned handle < slot_count
+                __m128i const in_range = _mm_cmpgt_epi32(biased_count, _mm_xor_si128(handles, sign_bias));
+                __m256i const gather_mask = _mm256_cvtepi32_epi64(in_range);
+                __m256i const slot_values = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), base, handles, gather_mask, 8);
+                __m256i const expected = _mm256_or_si256(_mm256_srli_epi64(values, 32), alive_mark);
+                __m256i const alive = _mm256_and_si256(_mm256_cmpeq_epi64(slot_values, expected), gather_mask);
+                auto const mask = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(alive)));
+                bits |= mask << (loop - first);
+            }
+            for(; loop < end; ++loop)
+            {
+                bits |= is_alive_bit(slots, slot_count, entities[loop]) << (loop - first);
+            }
+            return bits;
+        }
+
+        static void are_alive_avx2(entity_slot const* slots, size_t slot_count,
+            entity_t const* entities, size_t count, uint64_t* result_blocks, size_t first_bit)
+        {
+            // signed 32-bit gather indices can not address more slots
+            if(slot_count > static_cast<size_t>((std::numeric_limits<sint32_t>::max)()))
+            {
+                are_alive_scalar(slots, slot_count, entities, count, result_blocks, first_bit);
+                return;
+            }
+
+            for_each_result_block(count, result_blocks, first_bit, [=](size_t first, size_t end)
+                {
+                    return are_alive_avx2_bits(slots, slot_count, entities, first, end);
+                });
         }
+#endif
     };
 
-    entity_pool* entity_pool::create_entity_pool()
+    entity_pool* entity_pool::create_entity_pool(uint32_t max_entities_per_tag)
     {
-        return new entity_pool_impl{};
+        return new entity_pool_impl{ max_entities_per_tag };
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,148 @@
+#include "Types/GameInstance.h"
+
+namespace punk
+{
+    class game_instance_impl final : public game_instance
+    {
+    private:
+        uint32_t const                              index_;
+        core_partition const                        partition_;
+
+        // declared in dependency order, so they are destroyed in reverse
+        std::unique_ptr<work_stealing_executor>     executor_;
+        std::unique_ptr<chunk_allocator>            chunk_allocator_;
+        std::unique_ptr<runtime_type_system>        type_system_;
+        std::unique_ptr<runtime_archetype_system>   archetype_system_;
+        std::unique_ptr<entity_pool>                entity_pool_;
+        std::unique_ptr<system_scheduler>           system_scheduler_;
+
+    public:
+        game_instance_impl(uint32_t index, core_partition partition, game_engine_options const& options)
+            : index_(index)
+            , partition_(std::move(partition))
+        {
+            executor_.reset(work_stealing_executor::create_instance(work_stealing_executor_options
+                {
+                    .pin_workers = options.pin_workers,
+                    .cores = partition_.cores,
+                    .spin_count = options.spin_count,
+                    .name = std::format("punk.{}", index_),
+                }));
+            chunk_allocator_.reset(chunk_allocator::create_instance(
+                options.numa_local_memory ? partition_.numa_node : invalid_index_value(), options.max_chunk_count_per_instance));
+            type_system_.reset(runtime_type_system::create_instance());
+            archetype_system_.reset(runtime_archetype_system::create_instance(type_system_.get()));
+            entity_pool_.reset(entity_pool::create_entity_pool(options.max_entities_per_tag));
+            system_scheduler_.reset(system_scheduler::create_instance(type_system_.get(), executor_.get()));
+        }
+
+        virtual uint32_t get_index() const override
+        {
+            return index_;
+        }
+
+        virtual uint32_t get_numa_node() const override
+        {
+            return partition_.numa_node;
+        }
+
+        virtual std::span<uint32_t const> get_cores() const override
+        {
+            return partition_.cores;
+        }
+
+        virtual work_stealing_executor* get_executor() override
+        {
+            return executor_.get();
+        }
+
+        virtual runtime_type_system* get_type_system() override
+        {
+            return type_system_.get();
+        }
+
+        virtual runtime_archetype_system* get_archetype_system() override
+        {
+            return archetype_system_.get();
+        }
+
+        virtual entity_pool* get_entity_pool() override
+        {
+            return entity_pool_.get();
+        }
+
+        virtual chunk_allocator* get_chunk_allocator() override
+        {
+            return chunk_allocator_.get();
+        }
+
+        virtual system_scheduler* get_system_scheduler() override
+        {
+            return system_scheduler_.get();
+        }
+    };
+
+    class game_engine_impl final : public game_engine
+    {
+    private:
+        std::vector<numa_node_info>                         topology_;
+        std::vector<std::unique_ptr<game_instance_impl>>    instances_;
+
+    public:
+        explicit game_engine_impl(game_engine_options const& options)
+            : topology_(options.topology.empty() ? punk::get_numa_topology() : options.topology)
+        {
+            auto partitions = partition_cores(topology_, options.instance_count);
+            for(uint32_t index = 0; index < partitions.size(); ++index)
+            {
+                instances_.push_back(std::make_unique<game_instance_impl>(index, std::move(partitions[index]), options));
+            }
+
+            // the executors are linked before any instance schedules a task
+            if(options.borrow_policy == core_borrow_policy::none)
+            {
+                return;
+            }
+            for(auto& borrower : instances_)
+            {
+                for(auto& lender : instances_)
+                {
+                    if(borrower != lender && (options.borrow_policy == core_borrow_policy::any_numa_node ||
+                        borrower->get_numa_node() == lender->get_numa_node()))
+                    {
+                        borrower->get_executor()->add_neighbor(lender->get_executor());
+                    }
+                }
+            }
+        }
+
+        virtual ~game_engine_impl()
+        {
+            // a worker may still borrow from another executor until every executor is shut down
+            for(auto& instance : instances_)
+            {
+                instance->get_executor()->shutdown();
+            }
+        }
+
+        virtual uint32_t get_game_instance_count() const override
+        {
+            return static_cast<uint32_t>(instances_.size());
+        }
+
+        virtual game_instance* get_game_instance(uint32_t index) override
+        {
+            return index < instances_.size() ? instances_[index].get() : nullptr;
+        }
+
+        virtual std::span<numa_node_info const> get_numa_topology() const override
+        {
+            return topology_;
+        }
+    };
+
+    game_engine* game_engine::create_instance(game_engine_options const& options)
+    {
+        return new game_engine_impl{ options };
+    }
+}
@@ -16,6 +16,8 @@ namespace punk
         type_info->fields.resize(create_info.field_count);
         type_info->component_tag = create_info.component_tag;
         type_info->component_group = create_info.component_group;
+        type_info->arithmetic = create_info.arithmetic;
+        type_info->lane_blocked = create_info.lane_blocked;
         return type_info.release();
     }
 
@@ -93,18 +95,67 @@ namespace punk
         return type_info ? type_info->component_group : 0;
     }
 
+    bool is_type_arithmetic(type_info_t const* type_info)
+    {
+        return type_info ? type_info->arithmetic : false;
+    }
+
+    bool is_type_lane_blocked(type_info_t const* type_info)
+    {
+        return type_info ? type_info->lane_blocked : false;
+    }
+
     void update_hash_for_fields(type_info_t* type_info)
     {
-        std::vector<type_hash_t> all_fileds_type_hash{};
-        all_fileds_type_hash.reserve(type_info->fields.size());
+        // the layout hash covers the field types and offsets
+        struct field_layout_t
+        {
+            type_hash_t type_hash;
+            uint64_t    offset;
+        };
+        std::vector<field_layout_t> all_fields_layout{};
+        all_fields_layout.reserve(type_info->fields.size());
         std::transform(type_info->fields.begin(), type_info->fields.end(),
-            std::back_inserter(all_fileds_type_hash),
+            std::back_inserter(all_fields_layout),
             [](field_info_t const& field_info)
             {
-                return field_info.type->hash;
+                return field_layout_t{ field_info.type->hash, field_info.offset };
             });
-        type_info->hash.components.value2 = hash_memory(
-            reinterpret_cast<char const*>(all_fileds_type_hash.data()), all_fileds_type_hash.size() * sizeof(type_hash_t));
+        auto const layout_hash = hash_memory_64(
+            reinterpret_cast<char const*>(all_fields_layout.data()), all_fields_layout.size() * sizeof(field_layout_t));
+        type_info->hash.components.value2 = static_cast<uint32_t>(layout_hash ^ (layout_hash >> 32));
+    }
+
+    bool type_info_less(type_info_t const* lhs, type_info_t const* rhs)
+    {
+        auto const lhs_hash = get_type_name_hash(lhs);
+        auto const rhs_hash = get_type_name_hash(rhs);
+        if(lhs_hash != rhs_hash)
+        {
+            return lhs_hash < rhs_hash;
+        }
+        return lhs != rhs && lhs && rhs && lhs->name < rhs->name;
+    }
+
+    bool is_type_layout_equal(type_info_t const* lhs, type_info_t const* rhs)
+    {
+        if(lhs == rhs)
+        {
+            return true;
+        }
+        if(!lhs || !rhs)
+        {
+            return false;
+        }
+        return lhs->hash.value == rhs->hash.value
+            && lhs->size == rhs->size
+            && lhs->alignment == rhs->alignment
+            && lhs->name == rhs->name
+            && std::ranges::equal(lhs->fields, rhs->fields,
+                [](field_info_t const& lhs_field, field_info_t const& rhs_field)
+                {
+                    return lhs_field.offset == rhs_field.offset && is_type_layout_equal(lhs_field.type, rhs_field.type);
+                });
     }
 }
 
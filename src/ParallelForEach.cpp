@@ -0,0 +1,169 @@
+#include "Types/ParallelForEach.h"
+#include "CoreTypes.h"
+#include "Utils/Simd.hpp"
+
+namespace punk
+{
+    // where the column of a component is, in the chunks of its group
+    struct component_column_layout
+    {
+        uint32_t    group_index;
+        uint32_t    offset_in_chunk;
+        uint32_t    lane_width;
+        uint32_t    capacity_in_chunk;
+    };
+
+    inline error_code resolve_column_layouts(archetype_chunks_t const& chunks, std::span<type_info_t const* const> component_types,
+        std::vector<component_column_layout>& layouts)
+    {
+        auto const* archetype = chunks.archetype;
+        if(!archetype)
+        {
+            return error_code::invalid_archetype;
+        }
+
+        layouts.clear();
+        for(auto const* component_type : component_types)
+        {
+            auto const itr = std::ranges::find(archetype->component_types, component_type);
+            if(itr == archetype->component_types.end())
+            {
+                return error_code::component_not_exists;
+            }
+
+            auto const& component_info = archetype->component_infos[std::distance(archetype->component_types.begin(), itr)];
+            if(component_info.index_of_group >= chunks.group_chunks.size())
+            {
+                return error_code::invalid_archetype;
+            }
+
+            layouts.push_back(component_column_layout
+            {
+                .group_index = component_info.index_of_group,
+                .offset_in_chunk = component_info.offset_in_chunk,
+                .lane_width = component_info.lane_width,
+                .capacity_in_chunk = archetype->component_groups[component_info.index_of_group].capacity_in_chunk,
+            });
+        }
+        return error_code::succeed;
+    }
+
+    // cut the rows of the archetype at the chunk boundaries of every component,
+    // the element counts come from the chunks of the first component
+    inline error_code append_archetype_segments(archetype_chunks_t const& chunks, std::span<component_column_layout const> layouts,
+        std::vector<chunk_segment_t>& segments, std::vector<column_ref_t>& columns)
+    {
+        auto const& first_layout = layouts.front();
+        auto const first_chunks = chunks.group_chunks[first_layout.group_index];
+        for(size_t chunk_index = 0; chunk_index < first_chunks.size(); ++chunk_index)
+        {
+            auto const row_begin = static_cast<uint32_t>(chunk_index * first_layout.capacity_in_chunk);
+            auto const row_end = row_begin + first_chunks[chunk_index]->element_count;
+            for(auto row = row_begin; row < row_end;)
+            {
+                auto element_count = row_end - row;
+                for(auto const& layout : layouts)
+                {
+                    element_count = (std::min)(element_count, layout.capacity_in_chunk - row % layout.capacity_in_chunk);
+                }
+
+                segments.push_back(chunk_segment_t{ .element_count = element_count, .first_column = static_cast<uint32_t>(columns.size()) });
+                for(auto const& layout : layouts)
+                {
+                    auto const group_chunks = chunks.group_chunks[layout.group_index];
+                    auto const index_of_chunk = row / layout.capacity_in_chunk;
+                    if(index_of_chunk >= group_chunks.size())
+                    {
+                        return error_code::index_overflow;
+                    }
+
+                    columns.push_back(column_ref_t
+                    {
+                        .data = reinterpret_cast<uint8_t*>(group_chunks[index_of_chunk]) + layout.offset_in_chunk,
+                        .lane_width = layout.lane_width,
+                        .first_index = row % layout.capacity_in_chunk,
+                    });
+                }
+                row += element_count;
+            }
+        }
+        return error_code::succeed;
+    }
+
+    error_code plan_chunk_tasks(std::span<archetype_chunks_t const> chunks, std::span<type_info_t const* const> component_types,
+        parallel_for_options const& options, chunk_task_plan_t& plan)
+    {
+        assert(!component_types.empty());
+        plan.segments.clear();
+        plan.columns.clear();
+        plan.task_offsets.clear();
+
+        // segments of all the matched archetypes
+        std::vector<chunk_segment_t> segments;
+        std::vector<column_ref_t> columns;
+        std::vector<component_column_layout> layouts;
+        for(auto const& archetype_chunks : chunks)
+        {
+            auto result = resolve_column_layouts(archetype_chunks, component_types, layouts);
+            if(result == error_code::succeed)
+            {
+                result = append_archetype_segments(archetype_chunks, layouts, segments, columns);
+            }
+            if(result != error_code::succeed)
+            {
+                return result;
+            }
+        }
+
+        uint64_t element_count = 0;
+        for(auto const& segment : segments)
+        {
+            element_count += segment.element_count;
+        }
+        if(element_count == 0)
+        {
+            return error_code::succeed;
+        }
+
+        // the count of tasks to reach the target cost, each task takes an even share of the elements
+        auto const total_cost = element_count * (std::max)(options.cost_per_element, 1u);
+        auto task_count = (total_cost + (std::max)(options.target_task_cost, 1u) - 1) / (std::max)(options.target_task_cost, 1u);
+        if(options.max_task_count > 0)
+        {
+            task_count = (std::min)(task_count, uint64_t{ options.max_task_count });
+        }
+        auto const elements_per_task = align_up(static_cast<uint32_t>((element_count + task_count - 1) / task_count), simd_width);
+
+        // split the segments at the task boundaries
+        auto const component_count = component_types.size();
+        uint32_t task_element_count = 0;
+        plan.task_offsets.push_back(0);
+        for(auto const& segment : segments)
+        {
+            for(uint32_t element_offset = 0; element_offset < segment.element_count;)
+            {
+                auto const count = (std::min)(segment.element_count - element_offset, elements_per_task - task_element_count);
+                plan.segments.push_back(chunk_segment_t{ .element_count = count, .first_column = static_cast<uint32_t>(plan.columns.size()) });
+                for(size_t loop = 0; loop < component_count; ++loop)
+                {
+                    auto column = columns[segment.first_column + loop];
+                    column.first_index += element_offset;
+                    plan.columns.push_back(column);
+                }
+
+                element_offset += count;
+                task_element_count += count;
+                if(task_element_count == elements_per_task)
+                {
+                    plan.task_offsets.push_back(static_cast<uint32_t>(plan.segments.size()));
+                    task_element_count = 0;
+                }
+            }
+        }
+        if(task_element_count > 0)
+        {
+            plan.task_offsets.push_back(static_cast<uint32_t>(plan.segments.size()));
+        }
+        return error_code::succeed;
+    }
+}
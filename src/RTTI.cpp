@@ -1,7 +1,8 @@
 #include "Types/RTTI.h"
-#include "async_simple/coro/SpinLock.h"
+#include "Task/AdaptiveLock.h"
 #include "CoreTypes.h"
 #include "Utils/Hash.hpp"
+#include "Utils/Simd.hpp"
 
 #ifndef PUNK_ALLOCA
 #define PUNK_ALLOCA(type, count) static_cast<std::add_pointer_t<type>>(alloca(sizeof(type) * (count)))
@@ -12,13 +13,14 @@ namespace punk
     class runtime_type_system_impl final : public runtime_type_system
     {
     public:
-        using spin_lock_t = async_simple::coro::SpinLock;
-        using scoped_spin_lock_t = async_simple::coro::ScopedSpinLock;
+        using lock_t = adaptive_lock;
+        using scoped_lock_t = std::lock_guard<adaptive_lock>;
         using type_info_ptr = std::unique_ptr<type_info_t>;
-        using type_info_container = std::unordered_map<uint32_t, type_info_ptr>;
+        // keyed by name hash, the names tell apart the types of colliding name hashes
+        using type_info_container = std::unordered_multimap<uint32_t, type_info_ptr>;
 
     private:
-        mutable spin_lock_t type_lock;
+        mutable lock_t type_lock;
         type_info_container runtime_type_infos;
 
     public:
@@ -31,12 +33,13 @@ namespace punk
                 return nullptr;
             }
             auto const type_name_hash = hash_memory(type_name, std::strlen(type_name));
-            return get_type_info(type_name_hash);
+            scoped_lock_t lock{ type_lock };
+            return find_type_info(type_name_hash, type_name);
         }
 
         virtual type_info_t* get_type_info(uint32_t type_name_hash) const override
         {
-            scoped_spin_lock_t lock{ type_lock };
+            scoped_lock_t lock{ type_lock };
             auto itr = runtime_type_infos.find(type_name_hash);
             if(itr != runtime_type_infos.end())
             {
@@ -47,13 +50,11 @@ namespace punk
 
         virtual type_info_t const* register_type_info(type_info_t* type_info) override
         {
-            auto const type_name_hash = type_info->hash.components.value1;
-            scoped_spin_lock_t lock{ type_lock };
-            auto const emplace_result = runtime_type_infos.emplace(type_name_hash, type_info);
-            return emplace_result.first->second.get();
-            // TODO ... conflict when hash.component.value2 is not the same
+            scoped_lock_t lock{ type_lock };
+            return register_type_info_impl(type_info);
         }
 
+        // the waiting coroutines are resumed on their own executor, not inline by the thread which unlocks
         virtual Lazy<type_info_t const*> async_get_type_info(char const* type_name) const override
         {
             if(!type_name)
@@ -61,12 +62,13 @@ namespace punk
                 co_return nullptr;
             }
             auto const type_name_hash = hash_memory(type_name, std::strlen(type_name));
-            co_return co_await async_get_type_info(type_name_hash);
+            auto scope = co_await type_lock.co_scoped_lock(co_await async_simple::CurrentExecutor{});
+            co_return find_type_info(type_name_hash, type_name);
         }
 
         virtual Lazy<type_info_t const*> async_get_type_info(uint32_t type_name_hash) const override
         {
-            auto scope = type_lock.coScopedLock();
+            auto scope = co_await type_lock.co_scoped_lock(co_await async_simple::CurrentExecutor{});
             auto itr = runtime_type_infos.find(type_name_hash);
             if (itr != runtime_type_infos.end())
             {
@@ -76,11 +78,36 @@ namespace punk
         }
 
         virtual Lazy<type_info_t const*> async_register_type_info(type_info_t* type_info) override
+        {
+            auto scope = co_await type_lock.co_scoped_lock(co_await async_simple::CurrentExecutor{});
+            co_return register_type_info_impl(type_info);
+        }
+
+    private:
+        // requires the type lock
+        type_info_t* find_type_info(uint32_t type_name_hash, char const* type_name) const
+        {
+            auto [first, last] = runtime_type_infos.equal_range(type_name_hash);
+            auto itr = std::find_if(first, last,
+                [type_name](auto const& pair)
+                {
+                    return pair.second->name == type_name;
+                });
+            return itr != last ? itr->second.get() : nullptr;
+        }
+
+        // requires the type lock
+        // the registered one is returned if the type exists, nullptr if its layout differs from the registered one
+        type_info_t const* register_type_info_impl(type_info_t* type_info)
         {
             auto const type_name_hash = type_info->hash.components.value1;
-            auto scope = type_lock.coScopedLock();
-            auto const emplace_result = runtime_type_infos.emplace(type_name_hash, type_info);
-            co_return emplace_result.first->second.get();
+            auto const* registered = find_type_info(type_name_hash, type_info->name.c_str());
+            if(registered)
+            {
+                return is_type_layout_equal(registered, type_info) ? registered : nullptr;
+            }
+            runtime_type_infos.emplace(type_name_hash, type_info_ptr{ type_info });
+            return type_info;
         }
     };
 
@@ -112,18 +139,10 @@ namespace punk
         }
 
         // stable sort components by type hash value
-        std::ranges::stable_sort(all_comps,
-            [](auto const* lhs, auto const* rhs)
-            {
-                return get_type_name_hash(lhs) < get_type_name_hash(rhs);
-            });
+        std::ranges::stable_sort(all_comps, type_info_less);
 
-        // remove unique components
-        auto [end, _] = std::ranges::unique(all_comps,
-            [](auto const* lhs, auto const* rhs)
-            {
-                return get_type_name_hash(lhs) == get_type_name_hash(rhs);
-            });
+        // remove duplicated components, type infos are unique objects
+        auto [end, _] = std::ranges::unique(all_comps);
 
         // adapt the component count
         component_count = std::ranges::distance(all_comps.begin(), end);
@@ -139,6 +158,10 @@ namespace punk
         {
             return archetype;
         }
+        if(!archetype || std::ranges::find(component_types, component_types + component_count, nullptr) != component_types + component_count)
+        {
+            return nullptr;
+        }
         include_orders = include_orders ? include_orders : PUNK_ALLOCA(uint32_t, component_count);
 
         std::ranges::subrange orders{ include_orders, include_orders + component_count };
@@ -148,13 +171,13 @@ namespace punk
         std::ranges::stable_sort(orders,
             [component_types](auto const lhs, auto const rhs)
             {
-                return get_type_name_hash(component_types[lhs]) < get_type_name_hash(component_types[rhs]);
+                return type_info_less(component_types[lhs], component_types[rhs]);
             });
         // remove duplicate components
         auto [invalid_begin, invalid_end] = std::ranges::unique(orders,
             [component_types](auto const lhs, auto const rhs)
             {
-                return get_type_name_hash(component_types[lhs]) == get_type_name_hash(component_types[rhs]);
+                return component_types[lhs] == component_types[rhs];
             });
         // mark the removed duplicate components` order as invalid value
         std::ranges::for_each(invalid_begin, invalid_end, [](auto& order) { order = invalid_index_value(); });
@@ -169,14 +192,14 @@ namespace punk
         {
             return archetype;
         }
+        if(!archetype || std::ranges::find(component_types, component_types + component_count, nullptr) != component_types + component_count)
+        {
+            return nullptr;
+        }
 
-        std::ranges::stable_sort(component_types, component_types + component_count,
-            [](auto const* lhs, auto const* rhs)
-            {
-                return get_type_name_hash(lhs) < get_type_name_hash(rhs);
-            });
+        std::ranges::stable_sort(component_types, component_types + component_count, type_info_less);
 
-        return archetype_exclude_components(archetype, component_types, component_count);
+        return archetype_exclude_components_impl(archetype, component_types, component_count);
     }
 }
 
@@ -185,27 +208,35 @@ namespace punk
     class runtime_archetype_system_impl final : public runtime_archetype_system
     {
     public:
-        using spin_lock_t = async_simple::coro::SpinLock;
-        using scoped_spin_lock_t = async_simple::coro::ScopedSpinLock;
-        using archetype_container = std::unordered_map<uint32_t, archetype_weak>;
+        using lock_t = adaptive_lock;
+        using scoped_lock_t = std::lock_guard<adaptive_lock>;
+        // a hash hit is verified by the full component list
+        struct archetype_entry
+        {
+            archetype_t const*  archetype;
+            archetype_weak      weak_archetype;
+        };
+        using archetype_container = std::unordered_multimap<uint64_t, archetype_entry>;
 
     private:
         archetype_container all_archetypes;
-        spin_lock_t         archetype_lock;
+        lock_t         archetype_lock;
 
     public:
         explicit runtime_archetype_system_impl(runtime_type_system* runtime_type_system)
             : runtime_archetype_system(runtime_type_system) {}
 
     public:
-        virtual archetype_ptr get_archetype(uint32_t hash) override
+        virtual archetype_ptr get_archetype(uint64_t hash) override
         {
-            scoped_spin_lock_t lock{ archetype_lock };
-            auto itr = all_archetypes.find(hash);
-            if (itr != all_archetypes.end())
+            scoped_lock_t lock{ archetype_lock };
+            auto [first, last] = all_archetypes.equal_range(hash);
+            for(; first != last; ++first)
             {
-                auto result = itr->second.lock();
-                return result;
+                if(auto result = first->second.weak_archetype.lock())
+                {
+                    return result;
+                }
             }
             return nullptr;
         }
@@ -213,19 +244,24 @@ namespace punk
     protected:
         virtual archetype_ptr get_or_create_archetype_impl(type_info_t const** sorted_component_types, size_t component_count) override
         {
-            // calculate the sorted components hash, as the archetype hash value
-            auto* hash_ptr = PUNK_ALLOCA(uint32_t, component_count);
+            // calculate the 64-bit hash of the sorted components' name & layout hashes, as the archetype hash value
+            auto* hash_ptr = PUNK_ALLOCA(uint64_t, component_count);
             std::ranges::subrange all_hash{ hash_ptr, hash_ptr + component_count };
             std::ranges::subrange all_comps{ sorted_component_types, sorted_component_types + component_count };
             std::ranges::transform(all_comps, all_hash.begin(),
                 [](auto const* type_info)
                 {
-                    return get_type_name_hash(type_info);
+                    return get_type_hash(type_info).value;
                 });
-            auto const archetype_hash = hash_memory(reinterpret_cast<char const*>(all_hash.data()), sizeof(uint32_t) * all_hash.size());
+            auto const archetype_hash = hash_memory_64(reinterpret_cast<char const*>(all_hash.data()), sizeof(uint64_t) * all_hash.size());
 
-            // if found one, return
-            auto archetype = get_archetype(archetype_hash);
+            // if found one with the same components, return
+            archetype_ptr archetype;
+            std::vector<archetype_ptr> collided;
+            {
+                scoped_lock_t lock{ archetype_lock };
+                archetype = find_archetype(archetype_hash, sorted_component_types, component_count, collided);
+            }
             if(archetype)
             {
                 return archetype;
@@ -254,29 +290,31 @@ namespace punk
                 component_infos_ptr + new_archetype_components_count
             };
 
+            // include_orders holds the sorted permutation on entry and receives the merged indices,
+            // so the permutation is read from a copy, the entries past component_count are invalidated by the caller
+            auto* sorted_orders = PUNK_ALLOCA(uint32_t, component_count);
+            std::ranges::copy(include_orders, include_orders + component_count, sorted_orders);
             std::ranges::subrange orders{ include_orders, include_orders + component_count };
+            std::ranges::fill(orders, invalid_index_value());
             uint32_t i = 0, j = 0, index = 0;
             while(i < current_archetype_component_count && j < component_count)
             {
                 auto const* current_component_type = archetype->component_types[i];
-                auto const current_index = orders[j];
+                auto const current_index = sorted_orders[j];
                 auto const* current_append_type = component_types[current_index];
 
-                auto const current_hash = get_type_name_hash(current_component_type);
-                auto const append_hash = get_type_name_hash(current_append_type);
-
-                if(current_hash < append_hash)
+                if(type_info_less(current_component_type, current_append_type))
                 {
                     merge_comp_type_infos[index++] = current_component_type;
                     ++i;
                 }
-                else if(current_hash > append_hash)
+                else if(type_info_less(current_append_type, current_component_type))
                 {
-                    orders[current_index] = index++;
                     merge_comp_type_infos[index] = current_append_type;
+                    orders[current_index] = index++;
                     ++j;
                 }
-                else //(current_hash == append_hash)
+                else //(current_component_type == current_append_type)
                 {
                     orders[current_index] = invalid_index_value();
                     ++j;
@@ -285,20 +323,20 @@ namespace punk
 
             while(i < current_archetype_component_count)
             {
-                auto const* current_component_type = archetype->component_types[j];
+                auto const* current_component_type = archetype->component_types[i];
                 merge_comp_type_infos[index++] = current_component_type;
                 ++i;
             }
             while(j < component_count)
             {
-                auto const current_index = orders[j];
+                auto const current_index = sorted_orders[j];
                 auto const* current_append_type = component_types[current_index];
-                orders[current_index] = index++;
                 merge_comp_type_infos[index] = current_append_type;
+                orders[current_index] = index++;
                 ++j;
             }
 
-            return get_or_create_archetype_impl(merge_comp_type_infos.data(), merge_comp_type_infos.size());
+            return get_or_create_archetype_impl(merge_comp_type_infos.data(), index);
         }
 
         virtual archetype_ptr archetype_exclude_components_impl(archetype_ptr const& archetype,type_info_t const** component_types, size_t component_count) override
@@ -312,22 +350,20 @@ namespace punk
                 archetype->component_types,
                 subtract_type_infos,
                 difference_type_infos.begin(),
-                [](type_info_t const* lhs, type_info_t const* rhs)
-                {
-                    return get_type_name_hash(lhs) < get_type_name_hash(rhs);
-                });
+                type_info_less);
 
-            return get_or_create_archetype_impl(diff_comp_begin, std::ranges::distance(diff_comp_end, diff_comp_begin));
+            return get_or_create_archetype_impl(diff_comp_begin, std::ranges::distance(diff_comp_begin, diff_comp_end));
         }
 
     private:
-        archetype_ptr allocate_archetype(uint32_t hash, size_t component_count)
+        archetype_ptr allocate_archetype(uint64_t hash, size_t component_count)
         {
             archetype_ptr archetype = archetype_ptr
             {
                 new archetype_t{}, [this](archetype_t* archetype) { destroy_archetype(archetype); }
             };
-            archetype->hash = 0;
+            archetype->hash = hash;
+            archetype->lane_width = 1;
             archetype->registered = false;
             archetype->component_types.reserve(component_count);
             archetype->component_infos.reserve(component_count);
@@ -349,25 +385,52 @@ namespace punk
             }
         }
 
+        // requires the archetype lock, the colliding archetypes are handed to the caller to release after the lock,
+        // releasing the last reference here would unregister the archetype under the same lock
+        archetype_ptr find_archetype(uint64_t hash, type_info_t const** sorted_component_types, size_t component_count,
+            std::vector<archetype_ptr>& collided)
+        {
+            std::ranges::subrange all_comps{ sorted_component_types, sorted_component_types + component_count };
+            auto [first, last] = all_archetypes.equal_range(hash);
+            for(; first != last; ++first)
+            {
+                // verify the full component list, 64-bit hash collisions are rare but not impossible
+                auto result = first->second.weak_archetype.lock();
+                if(result && std::ranges::equal(result->component_types, all_comps))
+                {
+                    return result;
+                }
+                if(result)
+                {
+                    collided.push_back(std::move(result));
+                }
+            }
+            return nullptr;
+        }
+
         archetype_ptr register_archetype(archetype_ptr& archetype)
         {
             assert(archetype);
-            scoped_spin_lock_t lock{ archetype_lock };
-            auto [weak_archetype, result] = all_archetypes.emplace(archetype->hash, archetype);
-            if(result)
+            std::vector<archetype_ptr> collided;
+            scoped_lock_t lock{ archetype_lock };
+
+            // another thread may have registered the same archetype in the meantime
+            auto registered = find_archetype(archetype->hash, archetype->component_types.data(), archetype->component_types.size(), collided);
+            if(registered)
             {
-                return archetype;
+                return registered;
             }
-            auto result_archetype = weak_archetype->second.lock();
-            assert(result_archetype);
-            return result_archetype;
+            all_archetypes.emplace(archetype->hash, archetype_entry{ archetype.get(), archetype });
+            archetype->registered = true;
+            return archetype;
         }
 
         void unregister_archetype(archetype_t* archetype)
         {
-            scoped_spin_lock_t lock{ archetype_lock };
-            auto itr = all_archetypes.find(archetype->hash);
-            if(itr != all_archetypes.end())
+            scoped_lock_t lock{ archetype_lock };
+            auto [first, last] = all_archetypes.equal_range(archetype->hash);
+            auto itr = std::find_if(first, last, [archetype](auto const& pair) { return pair.second.archetype == archetype; });
+            if(itr != last)
             {
                 all_archetypes.erase(itr);
             }
@@ -389,6 +452,7 @@ namespace punk
                         .index_in_group = invalid_index_value(),
                         .index_of_group = invalid_index_value(),
                         .offset_in_chunk = 0,
+                        .lane_width = 1,
                     };
                 });
 
@@ -438,74 +502,108 @@ namespace punk
                         });
                 });
 
+            // select the SIMD lane width for the lane-blocked components
+            select_lane_width(archetype);
+
             // initialize memory capacity_in_chunk for component_group & offset_in_chunk for component
             search_chunck_offset_and_capacity(archetype);
         }
 
+        void select_lane_width(archetype_t* archetype)
+        {
+            assert(archetype);
+
+            // the narrowest arithmetic field of all lane-blockable components decides the lane width of the archetype
+            uint32_t min_field_size = 0;
+            for(auto const* component_type : archetype->component_types)
+            {
+                if(!is_component_lane_blockable(component_type))
+                {
+                    continue;
+                }
+                for(auto const& field : component_type->fields)
+                {
+                    auto const field_size = field.type->size;
+                    min_field_size = min_field_size == 0 ? field_size : (std::min)(min_field_size, field_size);
+                }
+            }
+
+            archetype->lane_width = select_simd_lane_width(min_field_size);
+            for(auto& component_info : archetype->component_infos)
+            {
+                auto const* component_type = archetype->component_types[component_info.index_in_archetype];
+                component_info.lane_width = is_component_lane_blockable(component_type) &&
+                    is_lane_block_fit(component_type->size, component_type->alignment, archetype->lane_width) ? archetype->lane_width : 1;
+            }
+        }
+
         void search_chunck_offset_and_capacity(archetype_t* archetype)
         {
             assert(archetype);
 
+            std::vector<column_layout_desc> columns;
+            std::vector<uint32_t> offsets;
             for(auto& component_group : archetype->component_groups)
             {
-                /// Search the capcity in chunk for each component group
-                // 1. accumulate all the component size
-                auto const all_comp_size = std::reduce(
-                    component_group.component_indices.begin(),
-                    component_group.component_indices.end(),
-                    0u, [archetype](uint32_t acc, uint32_t component_index)
+                // the capacity in chunk & offsets of the group follow the rules shared with the compile-time layouts
+                columns.clear();
+                std::ranges::transform(component_group.component_indices, std::back_inserter(columns),
+                    [archetype](uint32_t component_index)
                     {
                         assert(component_index < archetype->component_types.size());
                         auto const* component_type = archetype->component_types[component_index];
-                        return acc + component_type->size;
+                        return column_layout_desc
+                        {
+                            .size = component_type->size,
+                            .alignment = component_type->alignment,
+                            .lane_width = archetype->component_infos[component_index].lane_width,
+                        };
                     });
+                offsets.resize(columns.size());
 
-                // 2. We search the capacity with a initialize value of (data_block_size / all_comp_size + 1)
-                constexpr uint32_t data_block_size = chunk_t::chunke_size - sizeof(chunk_t);
-                uint32_t capacity = data_block_size / all_comp_size + 1;
-
-                // 3. search the best capacity, by considering the alignments
-                uint32_t chunk_size;
-                std::vector<uint32_t> offsets(component_group.component_indices.size(), 0u);
-                do
+                // the blocks of the lane-blocked columns may fit one by one but not side by side, then the group is plain
+                if(!is_group_block_fit(columns))
                 {
-                    capacity--;
-                    chunk_size = calculate_chunk_size_and_offsets(archetype, component_group, capacity, offsets);
-                } while (data_block_size <= chunk_size);
+                    for(uint32_t loop = 0; loop < columns.size(); ++loop)
+                    {
+                        columns[loop].lane_width = 1;
+                        archetype->component_infos[component_group.component_indices[loop]].lane_width = 1;
+                    }
+                }
+                component_group.capacity_in_chunk = calculate_group_layout(columns, offsets);
 
-                // 4. now we have got the capacity result and offsets of all components, update into the archetype/component info
-                component_group.capacity_in_chunk = capacity;
+                // update into the archetype/component info
                 for(uint32_t loop = 0; loop < offsets.size(); ++loop)
                 {
-                    archetype->component_infos[loop].offset_in_chunk = offsets[loop];
+                    auto const component_index = component_group.component_indices[loop];
+                    archetype->component_infos[component_index].offset_in_chunk = offsets[loop];
                 }
             }
         }
+    };
 
-        uint32_t calculate_chunk_size_and_offsets(archetype_t* archetype, component_group_info_t const& component_group, uint32_t capacity, std::vector<uint32_t>& offsets)
+    bool verify_component_layout(archetype_t const* archetype, type_info_t const* component_type,
+        static_component_layout const& layout, std::span<uint32_t const> field_offsets)
+    {
+        if(!archetype || !component_type)
         {
-            assert(archetype);
-            uint32_t size = sizeof(chunk_t);
-
-            offsets.clear();
-            std::ranges::transform(component_group.component_indices, std::back_inserter(offsets),
-                [archetype, &size, capacity](auto const& component_index)
-                {
-                    auto const* component_type = archetype->component_types[component_index];
-
-                    // adjust alignment for each component
-                    auto const offset = align_up(size, component_type->alignment);
-
-                    // accumulate chunk memory size
-                    size += component_type->size * capacity;
-
-                    // return the offset
-                    return offset;
-                });
+            return false;
+        }
 
-            return size;
+        auto const itr = std::ranges::find(archetype->component_types, component_type);
+        if(itr == archetype->component_types.end())
+        {
+            return false;
         }
-    };
+
+        auto const& component_info = archetype->component_infos[std::distance(archetype->component_types.begin(), itr)];
+        auto const& component_group = archetype->component_groups[component_info.index_of_group];
+        return component_info.offset_in_chunk == layout.offset_in_chunk
+            && component_group.capacity_in_chunk == layout.capacity_in_chunk
+            && component_info.lane_width == layout.lane_width
+            && std::ranges::equal(component_type->fields, field_offsets,
+                [](field_info_t const& field, uint32_t offset) { return field.offset == offset; });
+    }
 
     runtime_archetype_system* runtime_archetype_system::create_instance(runtime_type_system* rtt_system)
     {
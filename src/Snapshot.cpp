@@ -0,0 +1,625 @@
+#include "Types/Snapshot.h"
+#include "CoreTypes.h"
+#include "Utils/Hash.hpp"
+
+namespace punk
+{
+    // hex form of 'P' 'K' 'S' 'N'
+    constexpr uint32_t snapshot_magic = 0x4e534b50;
+    constexpr uint32_t snapshot_version = 1;
+
+    struct snapshot_header
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    chunk_count;
+        uint32_t    type_count;
+        uint64_t    type_table_offset;
+    };
+
+    // followed by name_length bytes of name and field_count snapshot_field_record
+    struct snapshot_type_record
+    {
+        uint64_t    hash;
+        uint32_t    size;
+        uint32_t    alignment;
+        uint32_t    name_length;
+        uint32_t    field_count;
+    };
+
+    struct snapshot_field_record
+    {
+        uint32_t    type_index;
+        uint32_t    offset;
+    };
+
+    // followed by component_count type indices of the archetype components and column_count columns
+    struct snapshot_chunk_record
+    {
+        uint32_t    component_count;
+        uint32_t    group_index;
+        uint32_t    element_count;
+        uint32_t    chunk_number;
+        uint32_t    column_count;
+    };
+
+    // followed by byte_size bytes of the column
+    struct snapshot_column_record
+    {
+        uint32_t    type_index;
+        uint32_t    lane_width;
+        uint64_t    byte_size;
+    };
+
+    // components with no copy function are copied as raw bytes
+    inline bool is_snapshot_copyable(type_info_t const* type)
+    {
+        return !type->vtable.copy_func && !type->vtable.destructor;
+    }
+
+    // lane-blocked columns always hold whole blocks
+    inline uint64_t get_column_byte_size(uint32_t element_count, uint32_t size, uint32_t lane_width)
+    {
+        auto const count = lane_width > 1 ? align_up(element_count, lane_width) : element_count;
+        return uint64_t{ count } * size;
+    }
+
+    inline void append_snapshot_bytes(std::vector<uint8_t>& buffer, void const* data, size_t size)
+    {
+        auto const* bytes = static_cast<uint8_t const*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    template <typename T> requires std::is_trivially_copyable_v<T>
+    void append_snapshot_data(std::vector<uint8_t>& buffer, T const& value)
+    {
+        append_snapshot_bytes(buffer, &value, sizeof(T));
+    }
+
+    // bounds checked reads over the snapshot data
+    class snapshot_cursor
+    {
+    private:
+        std::span<uint8_t const>    data_;
+        size_t                      position_ = 0;
+
+    public:
+        explicit snapshot_cursor(std::span<uint8_t const> data, size_t position = 0) noexcept
+            : data_(data)
+            , position_(position) {}
+
+        size_t get_position() const noexcept
+        {
+            return position_;
+        }
+
+        bool read_bytes(size_t size, uint8_t const*& result) noexcept
+        {
+            if(position_ > data_.size() || size > data_.size() - position_)
+            {
+                return false;
+            }
+            result = data_.data() + position_;
+            position_ += size;
+            return true;
+        }
+
+        template <typename T> requires std::is_trivially_copyable_v<T>
+        bool read(T& result) noexcept
+        {
+            uint8_t const* bytes;
+            if(!read_bytes(sizeof(T), bytes))
+            {
+                return false;
+            }
+            std::memcpy(&result, bytes, sizeof(T));
+            return true;
+        }
+    };
+}
+
+namespace punk
+{
+    class snapshot_writer_impl final : public snapshot_writer
+    {
+    private:
+        std::vector<uint8_t>                                buffer_;
+        size_t const                                        capacity_hint_;
+        std::vector<type_info_t const*>                     types_;
+        std::unordered_map<type_info_t const*, uint32_t>    type_indices_;
+        uint32_t                                            chunk_count_ = 0;
+
+    public:
+        explicit snapshot_writer_impl(size_t capacity_hint)
+            : capacity_hint_(capacity_hint)
+        {
+            reset();
+        }
+
+        virtual error_code write_chunk(archetype_t const* archetype, uint32_t group_index, chunk_t const* chunk) override
+        {
+            if(!archetype || !chunk || group_index >= archetype->component_groups.size())
+            {
+                return error_code::invalid_archetype;
+            }
+
+            // validate before writing, a failure leaves no partial record
+            auto const& group = archetype->component_groups[group_index];
+            if(chunk->element_count > group.capacity_in_chunk)
+            {
+                return error_code::index_overflow;
+            }
+            if(!std::ranges::all_of(group.component_indices,
+                [archetype](uint32_t component_index)
+                {
+                    return is_snapshot_copyable(archetype->component_types[component_index]);
+                }))
+            {
+                return error_code::snapshot_unsupported_type;
+            }
+
+            snapshot_chunk_record const record
+            {
+                .component_count = static_cast<uint32_t>(archetype->component_types.size()),
+                .group_index = group_index,
+                .element_count = chunk->element_count,
+                .chunk_number = chunk->chunk_number,
+                .column_count = static_cast<uint32_t>(group.component_indices.size()),
+            };
+            append_snapshot_data(buffer_, record);
+            for(auto const* component_type : archetype->component_types)
+            {
+                append_snapshot_data(buffer_, get_type_index(component_type));
+            }
+
+            // one memcpy per column
+            auto const* chunk_data = reinterpret_cast<uint8_t const*>(chunk);
+            for(auto const component_index : group.component_indices)
+            {
+                auto const* component_type = archetype->component_types[component_index];
+                auto const& component_info = archetype->component_infos[component_index];
+                snapshot_column_record const column
+                {
+                    .type_index = get_type_index(component_type),
+                    .lane_width = component_info.lane_width,
+                    .byte_size = get_column_byte_size(chunk->element_count, component_type->size, component_info.lane_width),
+                };
+                append_snapshot_data(buffer_, column);
+                append_snapshot_bytes(buffer_, chunk_data + component_info.offset_in_chunk, static_cast<size_t>(column.byte_size));
+            }
+
+            ++chunk_count_;
+            return error_code::succeed;
+        }
+
+        virtual std::vector<uint8_t> finish() override
+        {
+            snapshot_header const header
+            {
+                .magic = snapshot_magic,
+                .version = snapshot_version,
+                .chunk_count = chunk_count_,
+                .type_count = static_cast<uint32_t>(types_.size()),
+                .type_table_offset = buffer_.size(),
+            };
+
+            // the field types are indexed when their owner is, so the table is complete
+            for(auto const* type : types_)
+            {
+                snapshot_type_record const record
+                {
+                    .hash = type->hash.value,
+                    .size = type->size,
+                    .alignment = type->alignment,
+                    .name_length = static_cast<uint32_t>(type->name.size()),
+                    .field_count = static_cast<uint32_t>(type->fields.size()),
+                };
+                append_snapshot_data(buffer_, record);
+                append_snapshot_bytes(buffer_, type->name.data(), type->name.size());
+                for(auto const& field : type->fields)
+                {
+                    append_snapshot_data(buffer_, snapshot_field_record{ .type_index = type_indices_.at(field.type), .offset = field.offset });
+                }
+            }
+            std::memcpy(buffer_.data(), &header, sizeof(header));
+
+            auto result = std::move(buffer_);
+            reset();
+            return result;
+        }
+
+    private:
+        void reset()
+        {
+            buffer_.clear();
+            buffer_.reserve(capacity_hint_);
+            buffer_.resize(sizeof(snapshot_header));
+            types_.clear();
+            type_indices_.clear();
+            chunk_count_ = 0;
+        }
+
+        uint32_t get_type_index(type_info_t const* type)
+        {
+            auto itr = type_indices_.find(type);
+            if(itr != type_indices_.end())
+            {
+                return itr->second;
+            }
+
+            auto const index = static_cast<uint32_t>(types_.size());
+            types_.push_back(type);
+            type_indices_.emplace(type, index);
+            for(auto const& field : type->fields)
+            {
+                get_type_index(field.type);
+            }
+            return index;
+        }
+    };
+
+    snapshot_writer* snapshot_writer::create_instance(size_t capacity_hint)
+    {
+        return new snapshot_writer_impl{ capacity_hint };
+    }
+}
+
+namespace punk
+{
+    class snapshot_reader_impl final : public snapshot_reader
+    {
+    private:
+        struct saved_type
+        {
+            uint64_t            hash;
+            uint32_t            size;
+            uint32_t            alignment;
+            std::string_view    name;
+            uint32_t            first_field;
+            uint32_t            field_count;
+        };
+
+        struct saved_column
+        {
+            uint32_t            type_index;
+            uint32_t            lane_width;
+            uint8_t const*      data;
+            uint64_t            byte_size;
+        };
+
+        struct saved_chunk
+        {
+            uint32_t            group_index;
+            uint32_t            element_count;
+            uint32_t            chunk_number;
+            uint32_t            first_component;
+            uint32_t            component_count;
+            uint32_t            first_column;
+            uint32_t            column_count;
+        };
+
+        std::span<uint8_t const>            data_;
+        std::vector<saved_type>             types_;
+        std::vector<snapshot_field_record>  fields_;
+        std::vector<uint32_t>               components_;
+        std::vector<saved_column>           columns_;
+        std::vector<saved_chunk>            chunks_;
+
+    public:
+        explicit snapshot_reader_impl(std::span<uint8_t const> data)
+            : data_(data) {}
+
+        virtual error_code open() override
+        {
+            types_.clear();
+            fields_.clear();
+            components_.clear();
+            columns_.clear();
+            chunks_.clear();
+
+            snapshot_cursor cursor{ data_ };
+            snapshot_header header;
+            if(!cursor.read(header) || header.magic != snapshot_magic)
+            {
+                return error_code::snapshot_corrupted;
+            }
+            if(header.version != snapshot_version)
+            {
+                return error_code::snapshot_version_mismatch;
+            }
+            if(header.type_table_offset < sizeof(header) || header.type_table_offset > data_.size())
+            {
+                return error_code::snapshot_corrupted;
+            }
+
+            auto result = parse_types(snapshot_cursor{ data_, static_cast<size_t>(header.type_table_offset) }, header.type_count);
+            if(result == error_code::succeed)
+            {
+                result = parse_chunks(cursor, static_cast<size_t>(header.type_table_offset), header.chunk_count);
+            }
+            return result;
+        }
+
+        virtual size_t get_chunk_count() const override
+        {
+            return chunks_.size();
+        }
+
+        virtual uint32_t get_chunk_group_index(size_t chunk_index) const override
+        {
+            return chunk_index < chunks_.size() ? chunks_[chunk_index].group_index : invalid_index_value();
+        }
+
+        virtual uint32_t get_chunk_element_count(size_t chunk_index) const override
+        {
+            return chunk_index < chunks_.size() ? chunks_[chunk_index].element_count : 0;
+        }
+
+        virtual archetype_ptr resolve_archetype(size_t chunk_index, runtime_archetype_system* archetype_system, runtime_type_system* type_system) const override
+        {
+            if(chunk_index >= chunks_.size() || !archetype_system || !type_system)
+            {
+                return nullptr;
+            }
+
+            auto const& chunk = chunks_[chunk_index];
+            std::vector<type_info_t const*> component_types;
+            component_types.reserve(chunk.component_count);
+            for(uint32_t loop = 0; loop < chunk.component_count; ++loop)
+            {
+                std::string const type_name{ types_[components_[chunk.first_component + loop]].name };
+                auto const* component_type = type_system->get_type_info(type_name.c_str());
+                if(!component_type)
+                {
+                    return nullptr;
+                }
+                component_types.push_back(component_type);
+            }
+            return archetype_system->get_or_create_archetype(component_types.data(), component_types.size());
+        }
+
+        virtual error_code read_chunk(size_t chunk_index, archetype_t const* archetype, uint32_t group_index, chunk_t* chunk) const override
+        {
+            if(chunk_index >= chunks_.size())
+            {
+                return error_code::index_overflow;
+            }
+            if(!archetype || !chunk || group_index >= archetype->component_groups.size())
+            {
+                return error_code::invalid_archetype;
+            }
+
+            auto const& saved = chunks_[chunk_index];
+            auto const& group = archetype->component_groups[group_index];
+            if(saved.element_count > group.capacity_in_chunk)
+            {
+                return error_code::snapshot_archetype_mismatch;
+            }
+
+            chunk->element_count = saved.element_count;
+            chunk->chunk_number = saved.chunk_number;
+            auto* chunk_data = reinterpret_cast<uint8_t*>(chunk);
+            for(auto const component_index : group.component_indices)
+            {
+                auto const* component_type = archetype->component_types[component_index];
+                auto const& component_info = archetype->component_infos[component_index];
+                auto* column_data = chunk_data + component_info.offset_in_chunk;
+
+                // a component missing in the snapshot keeps its default value
+                auto const* column = find_column(saved, component_type);
+                if(!column)
+                {
+                    construct_column(component_type, column_data, saved.element_count, component_info.lane_width);
+                    continue;
+                }
+
+                // fast path, the same layout is copied as a whole
+                auto const& column_type = types_[column->type_index];
+                if(column_type.hash == component_type->hash.value && column_type.size == component_type->size &&
+                    column->lane_width == component_info.lane_width)
+                {
+                    std::memcpy(column_data, column->data, static_cast<size_t>(column->byte_size));
+                    continue;
+                }
+
+                construct_column(component_type, column_data, saved.element_count, component_info.lane_width);
+                for(uint32_t index = 0; index < saved.element_count; ++index)
+                {
+                    convert_element(column_type, column->data, column->lane_width, component_type, column_data, component_info.lane_width, index);
+                }
+            }
+            return error_code::succeed;
+        }
+
+    private:
+        error_code parse_types(snapshot_cursor cursor, uint32_t type_count)
+        {
+            types_.reserve(type_count);
+            for(uint32_t loop = 0; loop < type_count; ++loop)
+            {
+                snapshot_type_record record;
+                uint8_t const* name;
+                if(!cursor.read(record) || !cursor.read_bytes(record.name_length, name))
+                {
+                    return error_code::snapshot_corrupted;
+                }
+
+                types_.push_back(saved_type
+                {
+                    .hash = record.hash,
+                    .size = record.size,
+                    .alignment = record.alignment,
+                    .name = std::string_view{ reinterpret_cast<char const*>(name), record.name_length },
+                    .first_field = static_cast<uint32_t>(fields_.size()),
+                    .field_count = record.field_count,
+                });
+                for(uint32_t field_loop = 0; field_loop < record.field_count; ++field_loop)
+                {
+                    snapshot_field_record field;
+                    if(!cursor.read(field) || field.type_index >= type_count)
+                    {
+                        return error_code::snapshot_corrupted;
+                    }
+                    fields_.push_back(field);
+                }
+            }
+
+            // the conversion reads the fields in place, so they must lie inside their owner
+            for(auto const& type : types_)
+            {
+                for(uint32_t loop = 0; loop < type.field_count; ++loop)
+                {
+                    auto const& field = fields_[type.first_field + loop];
+                    if(uint64_t{ field.offset } + types_[field.type_index].size > type.size)
+                    {
+                        return error_code::snapshot_corrupted;
+                    }
+                }
+            }
+            return error_code::succeed;
+        }
+
+        error_code parse_chunks(snapshot_cursor& cursor, size_t end, uint32_t chunk_count)
+        {
+            auto const type_count = types_.size();
+            chunks_.reserve(chunk_count);
+            while(cursor.get_position() < end)
+            {
+                snapshot_chunk_record record;
+                if(!cursor.read(record))
+                {
+                    return error_code::snapshot_corrupted;
+                }
+
+                saved_chunk chunk
+                {
+                    .group_index = record.group_index,
+                    .element_count = record.element_count,
+                    .chunk_number = record.chunk_number,
+                    .first_component = static_cast<uint32_t>(components_.size()),
+                    .component_count = record.component_count,
+                    .first_column = static_cast<uint32_t>(columns_.size()),
+                    .column_count = record.column_count,
+                };
+                for(uint32_t loop = 0; loop < record.component_count; ++loop)
+                {
+                    uint32_t type_index;
+                    if(!cursor.read(type_index) || type_index >= type_count)
+                    {
+                        return error_code::snapshot_corrupted;
+                    }
+                    components_.push_back(type_index);
+                }
+                for(uint32_t loop = 0; loop < record.column_count; ++loop)
+                {
+                    snapshot_column_record column;
+                    uint8_t const* column_data;
+                    if(!cursor.read(column) || column.type_index >= type_count ||
+                        column.byte_size != get_column_byte_size(record.element_count, types_[column.type_index].size, column.lane_width) ||
+                        !cursor.read_bytes(static_cast<size_t>(column.byte_size), column_data))
+                    {
+                        return error_code::snapshot_corrupted;
+                    }
+                    columns_.push_back(saved_column
+                    {
+                        .type_index = column.type_index,
+                        .lane_width = column.lane_width,
+                        .data = column_data,
+                        .byte_size = column.byte_size,
+                    });
+                }
+                chunks_.push_back(chunk);
+            }
+            return cursor.get_position() == end && chunks_.size() == chunk_count ? error_code::succeed : error_code::snapshot_corrupted;
+        }
+
+        saved_column const* find_column(saved_chunk const& chunk, type_info_t const* component_type) const
+        {
+            for(uint32_t loop = 0; loop < chunk.column_count; ++loop)
+            {
+                auto const& column = columns_[chunk.first_column + loop];
+                if(types_[column.type_index].name == component_type->name)
+                {
+                    return &column;
+                }
+            }
+            return nullptr;
+        }
+
+        static void construct_column(type_info_t const* type, uint8_t* column_data, uint32_t element_count, uint32_t lane_width)
+        {
+            if(!type->vtable.constructor)
+            {
+                std::memset(column_data, 0, static_cast<size_t>(get_column_byte_size(element_count, type->size, lane_width)));
+                return;
+            }
+
+            // lane-blocked components are arithmetic only, so they never have a constructor
+            for(uint32_t index = 0; index < element_count; ++index)
+            {
+                type->vtable.constructor(column_data + size_t{ index } * type->size);
+            }
+        }
+
+        // fields carry no names, a saved field is matched by its index and the name of its type
+        snapshot_field_record const* find_field(saved_type const& type, size_t field_index, type_info_t const* field_type) const
+        {
+            if(field_index >= type.field_count)
+            {
+                return nullptr;
+            }
+            auto const& field = fields_[type.first_field + field_index];
+            return types_[field.type_index].name == field_type->name ? &field : nullptr;
+        }
+
+        void convert_element(saved_type const& src_type, uint8_t const* src_column, uint32_t src_lane_width,
+            type_info_t const* dst_type, uint8_t* dst_column, uint32_t dst_lane_width, uint32_t index) const
+        {
+            if(src_lane_width <= 1 && dst_lane_width <= 1)
+            {
+                convert_value(src_type, src_column + size_t{ index } * src_type.size, dst_type, dst_column + size_t{ index } * dst_type->size);
+                return;
+            }
+
+            // the lane-blocked fields are interleaved, so they are addressed one by one
+            for(size_t field_index = 0; field_index < dst_type->fields.size(); ++field_index)
+            {
+                auto const& dst_field = dst_type->fields[field_index];
+                auto const* src_field = find_field(src_type, field_index, dst_field.type);
+                if(!src_field)
+                {
+                    continue;
+                }
+
+                auto const& src_field_type = types_[src_field->type_index];
+                auto const src_offset = get_column_field_offset(index, src_type.size, src_lane_width, src_field->offset, src_field_type.size);
+                auto const dst_offset = get_column_field_offset(index, dst_type->size, dst_lane_width, dst_field.offset, dst_field.type->size);
+                convert_value(src_field_type, src_column + src_offset, dst_field.type, dst_column + dst_offset);
+            }
+        }
+
+        void convert_value(saved_type const& src_type, uint8_t const* src, type_info_t const* dst_type, uint8_t* dst) const
+        {
+            if(src_type.hash == dst_type->hash.value && src_type.size == dst_type->size)
+            {
+                std::memcpy(dst, src, src_type.size);
+                return;
+            }
+
+            for(size_t field_index = 0; field_index < dst_type->fields.size(); ++field_index)
+            {
+                auto const& dst_field = dst_type->fields[field_index];
+                auto const* src_field = find_field(src_type, field_index, dst_field.type);
+                if(src_field)
+                {
+                    convert_value(types_[src_field->type_index], src + src_field->offset, dst_field.type, dst + dst_field.offset);
+                }
+            }
+        }
+    };
+
+    snapshot_reader* snapshot_reader::create_instance(std::span<uint8_t const> data)
+    {
+        return new snapshot_reader_impl{ data };
+    }
+}
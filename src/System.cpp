@@ -0,0 +1,431 @@
+#include "Types/System.h"
+#include "async_simple/Try.h"
+#include <atomic>
+#include <mutex>
+
+namespace punk
+{
+    void normalize_system_access(system_access_t& access)
+    {
+        auto const sort_unique = [](std::vector<type_info_t const*>& types)
+            {
+                std::erase(types, nullptr);
+                std::ranges::sort(types);
+                types.erase(std::unique(types.begin(), types.end()), types.end());
+            };
+        sort_unique(access.reads);
+        sort_unique(access.writes);
+
+        // written types are accessed exclusively anyway
+        std::erase_if(access.reads, [&access](type_info_t const* type) { return std::ranges::binary_search(access.writes, type); });
+    }
+
+    inline bool has_common_type(std::vector<type_info_t const*> const& lhs, std::vector<type_info_t const*> const& rhs)
+    {
+        auto lhs_itr = lhs.begin();
+        auto rhs_itr = rhs.begin();
+        while(lhs_itr != lhs.end() && rhs_itr != rhs.end())
+        {
+            if(*lhs_itr == *rhs_itr)
+            {
+                return true;
+            }
+            *lhs_itr < *rhs_itr ? ++lhs_itr : ++rhs_itr;
+        }
+        return false;
+    }
+
+    bool is_system_access_conflict(system_access_t const& lhs, system_access_t const& rhs)
+    {
+        return has_common_type(lhs.writes, rhs.writes) || has_common_type(lhs.writes, rhs.reads) || has_common_type(lhs.reads, rhs.writes);
+    }
+
+    class system_scheduler_impl final : public system_scheduler
+    {
+    private:
+        struct system_node
+        {
+            std::unique_ptr<system_base>    system;
+            system_access_t                 access;
+            system_schedule_t               schedule;
+            std::vector<uint32_t>           predecessors{};
+            std::vector<uint32_t>           successors{};   // in launch order
+
+            // written by the completion of the system, read by run_frame after the phase completed
+            frame_budget_t                  budget{};
+            frame_clock::time_point         start_time{};
+            frame_clock::duration           estimated_cost{};
+            uint32_t                        deferred_frames = 0;
+        };
+
+        // resumes run_frame once every system of the phase has completed
+        struct phase_awaiter
+        {
+            system_scheduler_impl*          scheduler;
+            std::vector<uint32_t> const&    members;
+            std::vector<uint32_t> const&    roots;
+
+            bool await_ready() const noexcept
+            {
+                return members.empty();
+            }
+
+            bool await_suspend(std::coroutine_handle<> continuation)
+            {
+                return scheduler->start_phase(members, roots, continuation);
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        std::vector<system_node>                    nodes_;
+        std::unique_ptr<std::atomic<uint32_t>[]>    pending_dependencies_;
+        bool                                        graph_dirty_ = false;
+
+        // the critical & normal systems, with a graph rebuilt only when the systems changed
+        std::vector<uint32_t>                       mandatory_members_;
+        std::vector<uint32_t>                       mandatory_roots_;
+        // the deferrable systems, the graph is rebuilt for the admitted ones when some of them are deferred
+        std::vector<uint32_t>                       deferrable_members_;
+        std::vector<uint32_t>                       admitted_members_;
+        std::vector<uint32_t>                       admitted_roots_;
+        bool                                        all_deferrable_admitted_ = false;
+
+        // states of the running phase
+        std::atomic<uint32_t>                       pending_systems_ = 0;
+        std::coroutine_handle<>                     phase_continuation_;
+        std::mutex                                  exception_mutex_;
+        std::exception_ptr                          exception_;
+
+        frame_stats_t                               last_frame_stats_;
+
+    public:
+        system_scheduler_impl(runtime_type_system* rtt_system, async_simple::Executor* executor)
+            : system_scheduler(rtt_system, executor) {}
+
+        virtual system_base* add_system(std::unique_ptr<system_base> system) override
+        {
+            assert(runtime_type_system_);
+            if(!system)
+            {
+                return nullptr;
+            }
+
+            auto access = system->get_access(runtime_type_system_);
+            normalize_system_access(access);
+            auto const schedule = system->get_schedule();
+
+            auto* result = system.get();
+            nodes_.push_back(system_node{ .system = std::move(system), .access = std::move(access), .schedule = schedule });
+            graph_dirty_ = true;
+            return result;
+        }
+
+        virtual bool remove_system(system_base* system) override
+        {
+            auto const count = std::erase_if(nodes_, [system](system_node const& node) { return node.system.get() == system; });
+            graph_dirty_ |= count > 0;
+            return count > 0;
+        }
+
+        virtual size_t get_system_count() const override
+        {
+            return nodes_.size();
+        }
+
+        virtual std::vector<system_base*> get_dependencies(system_base const* system) override
+        {
+            update_graph();
+            admit_all_deferrable_systems();
+
+            std::vector<system_base*> result;
+            auto const itr = std::ranges::find_if(nodes_, [system](system_node const& node) { return node.system.get() == system; });
+            if(itr != nodes_.end())
+            {
+                std::ranges::transform(itr->predecessors, std::back_inserter(result),
+                    [this](uint32_t index) { return nodes_[index].system.get(); });
+            }
+            return result;
+        }
+
+        virtual Lazy<void> run_frame(frame_clock::duration budget) override
+        {
+            assert(executor_);
+            update_graph();
+
+            auto const frame_start = frame_clock::now();
+            auto const deadline = budget >= frame_clock::time_point::max() - frame_start ?
+                frame_clock::time_point::max() : frame_start + budget;
+            for(auto const index : mandatory_members_)
+            {
+                nodes_[index].budget = frame_budget_t{ .frame_start = frame_start, .deadline = deadline, .slice_end = deadline };
+            }
+
+            co_await phase_awaiter{ this, mandatory_members_, mandatory_roots_ };
+            auto const mandatory_end = frame_clock::now();
+            last_frame_stats_ = frame_stats_t{ .mandatory_time = mandatory_end - frame_start };
+
+            // a failed frame skips the deferrable systems
+            if(!exception_)
+            {
+                admit_deferrable_systems(frame_start, deadline, mandatory_end);
+                co_await phase_awaiter{ this, admitted_members_, admitted_roots_ };
+            }
+
+            auto const frame_end = frame_clock::now();
+            last_frame_stats_.frame_time = frame_end - frame_start;
+            last_frame_stats_.deadline_missed = frame_end > deadline;
+
+            // rethrow the first exception of the systems
+            if(exception_)
+            {
+                std::rethrow_exception(std::exchange(exception_, nullptr));
+            }
+        }
+
+        virtual frame_stats_t get_last_frame_stats() const override
+        {
+            return last_frame_stats_;
+        }
+
+    private:
+        // critical before normal before deferrable, then the higher priority, then the order they are added
+        bool launches_before(uint32_t lhs, uint32_t rhs) const noexcept
+        {
+            auto const& lhs_schedule = nodes_[lhs].schedule;
+            auto const& rhs_schedule = nodes_[rhs].schedule;
+            if(lhs_schedule.budget != rhs_schedule.budget)
+            {
+                return lhs_schedule.budget < rhs_schedule.budget;
+            }
+            if(lhs_schedule.priority != rhs_schedule.priority)
+            {
+                return lhs_schedule.priority > rhs_schedule.priority;
+            }
+            return lhs < rhs;
+        }
+
+        void update_graph()
+        {
+            if(!graph_dirty_)
+            {
+                return;
+            }
+            graph_dirty_ = false;
+
+            mandatory_members_.clear();
+            deferrable_members_.clear();
+            for(uint32_t index = 0; index < nodes_.size(); ++index)
+            {
+                auto& members = nodes_[index].schedule.budget == budget_class::deferrable ? deferrable_members_ : mandatory_members_;
+                members.push_back(index);
+            }
+            build_graph(mandatory_members_, mandatory_roots_);
+
+            // the deferrable systems only depend on each other, as they run after all the others
+            all_deferrable_admitted_ = false;
+            admit_all_deferrable_systems();
+            pending_dependencies_ = std::make_unique<std::atomic<uint32_t>[]>(nodes_.size());
+        }
+
+        void admit_all_deferrable_systems()
+        {
+            if(!std::exchange(all_deferrable_admitted_, true))
+            {
+                admitted_members_ = deferrable_members_;
+                build_graph(admitted_members_, admitted_roots_);
+            }
+        }
+
+        // a system depends on the last writer of the types it accesses, and writers also depend on the readers since then,
+        // members are in the order they are added
+        void build_graph(std::vector<uint32_t> const& members, std::vector<uint32_t>& roots)
+        {
+            struct type_access_state
+            {
+                std::optional<uint32_t> writer;
+                std::vector<uint32_t>   readers;
+            };
+            std::unordered_map<type_info_t const*, type_access_state> type_states;
+
+            roots.clear();
+            for(auto const index : members)
+            {
+                nodes_[index].predecessors.clear();
+                nodes_[index].successors.clear();
+            }
+
+            for(auto const index : members)
+            {
+                auto& node = nodes_[index];
+                for(auto const* type : node.access.reads)
+                {
+                    auto& state = type_states[type];
+                    if(state.writer)
+                    {
+                        node.predecessors.push_back(*state.writer);
+                    }
+                    state.readers.push_back(index);
+                }
+
+                for(auto const* type : node.access.writes)
+                {
+                    auto& state = type_states[type];
+                    if(state.writer)
+                    {
+                        node.predecessors.push_back(*state.writer);
+                    }
+                    node.predecessors.insert(node.predecessors.end(), state.readers.begin(), state.readers.end());
+                    state.writer = index;
+                    state.readers.clear();
+                }
+
+                std::ranges::sort(node.predecessors);
+                node.predecessors.erase(std::unique(node.predecessors.begin(), node.predecessors.end()), node.predecessors.end());
+                for(auto const predecessor : node.predecessors)
+                {
+                    nodes_[predecessor].successors.push_back(index);
+                }
+
+                if(node.predecessors.empty())
+                {
+                    roots.push_back(index);
+                }
+            }
+
+            auto const launch_order = [this](uint32_t lhs, uint32_t rhs) { return launches_before(lhs, rhs); };
+            std::ranges::sort(roots, launch_order);
+            for(auto const index : members)
+            {
+                std::ranges::sort(nodes_[index].successors, launch_order);
+            }
+        }
+
+        // the most starved deferrable systems first, the highest priority among equally starved ones, each admitted while the estimated costs of all
+        // the admitted ones still fit before the deadline as if they ran one after another, the others are deferred,
+        // unless deferred for max_deferred_frames, then they get a time slice of at least min_time_slice
+        void admit_deferrable_systems(frame_clock::time_point frame_start, frame_clock::time_point deadline, frame_clock::time_point now)
+        {
+            std::vector<uint32_t> candidates = deferrable_members_;
+            std::ranges::sort(candidates, [this](uint32_t lhs, uint32_t rhs)
+                {
+                    auto const& lhs_node = nodes_[lhs];
+                    auto const& rhs_node = nodes_[rhs];
+                    if(lhs_node.deferred_frames != rhs_node.deferred_frames)
+                    {
+                        return lhs_node.deferred_frames > rhs_node.deferred_frames;
+                    }
+                    if(lhs_node.schedule.priority != rhs_node.schedule.priority)
+                    {
+                        return lhs_node.schedule.priority > rhs_node.schedule.priority;
+                    }
+                    return lhs < rhs;
+                });
+
+            std::vector<uint32_t> admitted;
+            auto admitted_end = now;
+            for(auto const index : candidates)
+            {
+                auto& node = nodes_[index];
+                auto slice_end = deadline;
+                if(deadline == frame_clock::time_point::max() ||
+                    (admitted_end < deadline && node.estimated_cost <= deadline - admitted_end))
+                {
+                    admitted_end += node.estimated_cost;
+                }
+                else if(node.schedule.max_deferred_frames > 0 && node.deferred_frames >= node.schedule.max_deferred_frames)
+                {
+                    slice_end = (std::max)(deadline, now + std::chrono::duration_cast<frame_clock::duration>(node.schedule.min_time_slice));
+                }
+                else
+                {
+                    ++node.deferred_frames;
+                    ++last_frame_stats_.deferred_count;
+                    continue;
+                }
+
+                node.deferred_frames = 0;
+                node.budget = frame_budget_t{ .frame_start = frame_start, .deadline = deadline, .slice_end = slice_end };
+                admitted.push_back(index);
+            }
+            last_frame_stats_.deferrable_run_count = static_cast<uint32_t>(admitted.size());
+
+            // the graph of all the deferrable systems is kept while the frames are ahead of budget
+            if(admitted.size() == deferrable_members_.size())
+            {
+                admit_all_deferrable_systems();
+                return;
+            }
+            std::ranges::sort(admitted);
+            if(admitted != admitted_members_)
+            {
+                admitted_members_ = std::move(admitted);
+                build_graph(admitted_members_, admitted_roots_);
+                all_deferrable_admitted_ = false;
+            }
+        }
+
+        // returns false if the phase has already completed
+        bool start_phase(std::vector<uint32_t> const& members, std::vector<uint32_t> const& roots, std::coroutine_handle<> continuation)
+        {
+            phase_continuation_ = continuation;
+            for(auto const index : members)
+            {
+                pending_dependencies_[index].store(static_cast<uint32_t>(nodes_[index].predecessors.size()), std::memory_order_relaxed);
+            }
+
+            // one extra count held until all roots are launched
+            pending_systems_.store(static_cast<uint32_t>(members.size()) + 1, std::memory_order_relaxed);
+            for(auto const root : roots)
+            {
+                launch_system(root);
+            }
+            return pending_systems_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+
+        void launch_system(uint32_t index)
+        {
+            auto& node = nodes_[index];
+            node.start_time = frame_clock::now();
+            node.system->update(node.budget).via(executor_).start(
+                [this, index](async_simple::Try<void> result)
+                {
+                    if(result.hasError())
+                    {
+                        std::lock_guard lock{ exception_mutex_ };
+                        if(!exception_)
+                        {
+                            exception_ = result.getException();
+                        }
+                    }
+                    complete_system(index);
+                });
+        }
+
+        void complete_system(uint32_t index)
+        {
+            // moving average of the run time, which admits the deferrable systems
+            auto& node = nodes_[index];
+            auto const cost = frame_clock::now() - node.start_time;
+            node.estimated_cost += (cost - node.estimated_cost) / 4;
+
+            for(auto const successor : node.successors)
+            {
+                if(pending_dependencies_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    launch_system(successor);
+                }
+            }
+
+            if(pending_systems_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::exchange(phase_continuation_, nullptr).resume();
+            }
+        }
+    };
+
+    system_scheduler* system_scheduler::create_instance(runtime_type_system* rtt_system, async_simple::Executor* executor)
+    {
+        return new system_scheduler_impl{ rtt_system, executor };
+    }
+}
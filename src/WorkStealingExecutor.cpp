@@ -0,0 +1,427 @@
+#include "Task/WorkStealingExecutor.h"
+#include "Utils/ChaseLevDeque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace punk
+{
+    inline void pin_current_thread(uint32_t core)
+    {
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(core, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+    }
+
+    // executors linked for borrowing, appended by the setup thread while the workers may already be reading it
+    template <typename T>
+    class executor_link_list
+    {
+    private:
+        static constexpr uint32_t max_link_count = 64;
+
+        std::array<std::atomic<T*>, max_link_count> links_{};
+        std::atomic<uint32_t>                       count_ = 0;
+
+    public:
+        bool add(T* link) noexcept
+        {
+            auto const count = count_.load(std::memory_order_relaxed);
+            if(count >= max_link_count || contains(link))
+            {
+                return false;
+            }
+            links_[count].store(link, std::memory_order_relaxed);
+            count_.store(count + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool contains(T const* link) const noexcept
+        {
+            return any_of([link](T const* other) { return other == link; });
+        }
+
+        template <typename Pred>
+        bool any_of(Pred&& pred) const
+        {
+            auto const count = count_.load(std::memory_order_acquire);
+            for(uint32_t index = 0; index < count; ++index)
+            {
+                if(pred(links_[index].load(std::memory_order_relaxed)))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    class work_stealing_executor_impl final : public work_stealing_executor
+    {
+    private:
+        // a borrowed task runs on a worker of another executor, the owner still accounts for it
+        struct task_t
+        {
+            Func                            func;
+            work_stealing_executor_impl*    owner;
+        };
+
+        struct alignas(cache_line_size) worker_t
+        {
+            chase_lev_deque<task_t*>    deque;
+            std::thread                 thread;
+            uint32_t                    index;
+            uint32_t                    random_state;
+        };
+
+        struct current_worker_t
+        {
+            work_stealing_executor_impl const*  executor;
+            worker_t*                           worker;
+        };
+        static thread_local current_worker_t current_worker_;
+
+        std::vector<std::unique_ptr<worker_t>>  workers_;
+        uint32_t                                spin_count_;
+
+        // tasks scheduled from threads out of the executor
+        std::mutex                              injection_mutex_;
+        std::deque<task_t*>                     injection_queue_;
+        std::atomic<size_t>                     injection_count_ = 0;
+
+        // parking, workers wait on the epoch & schedulers bump it when any worker is parked
+        std::atomic<uint32_t>                   wake_epoch_ = 0;
+        std::atomic<uint32_t>                   parked_count_ = 0;
+        std::atomic<bool>                       stopping_ = false;
+        std::atomic<size_t>                     pending_count_ = 0;
+        bool                                    shut_down_ = false;
+
+        // executors this one borrows tasks from & executors borrowing from this one
+        executor_link_list<work_stealing_executor_impl> neighbors_;
+        executor_link_list<work_stealing_executor_impl> borrowers_;
+
+    public:
+        explicit work_stealing_executor_impl(work_stealing_executor_options const& options)
+            : work_stealing_executor(options.name)
+            , spin_count_(options.spin_count)
+        {
+            auto const core_count = (std::max)(std::thread::hardware_concurrency(), 1u);
+            auto const worker_count = options.worker_count > 0 ? options.worker_count :
+                !options.cores.empty() ? static_cast<uint32_t>(options.cores.size()) : core_count;
+            for(uint32_t index = 0; index < worker_count; ++index)
+            {
+                auto worker = std::make_unique<worker_t>();
+                worker->index = index;
+                worker->random_state = index * 0x9e3779b9u + 1;
+                workers_.push_back(std::move(worker));
+            }
+
+            // all the deques exist before any worker starts stealing
+            for(auto& worker : workers_)
+            {
+                auto const core = !options.pin_workers ? std::nullopt : std::optional<uint32_t>{
+                    !options.cores.empty() ? options.cores[worker->index % options.cores.size()] : worker->index % core_count };
+                worker->thread = std::thread{ [this, worker = worker.get(), core]() { run_worker(*worker, core); } };
+            }
+        }
+
+        virtual ~work_stealing_executor_impl()
+        {
+            shutdown();
+        }
+
+        virtual void add_neighbor(work_stealing_executor* neighbor) override
+        {
+            auto* impl = static_cast<work_stealing_executor_impl*>(neighbor);
+            if(impl != this && neighbors_.add(impl))
+            {
+                impl->borrowers_.add(this);
+            }
+        }
+
+        virtual void shutdown() override
+        {
+            if(std::exchange(shut_down_, true))
+            {
+                return;
+            }
+
+            stopping_.store(true, std::memory_order_seq_cst);
+            wake_epoch_.fetch_add(1, std::memory_order_seq_cst);
+            wake_epoch_.notify_all();
+            for(auto& worker : workers_)
+            {
+                worker->thread.join();
+            }
+
+            // tasks injected since the workers left, and tasks of ours still running on a borrower which may inject more
+            while(pending_count_.load(std::memory_order_acquire) > 0)
+            {
+                if(auto* task = take_injected_task())
+                {
+                    run_task(task);
+                    continue;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        virtual bool schedule(Func func) override
+        {
+            if(!func)
+            {
+                return false;
+            }
+
+            auto* task = new task_t{ std::move(func), this };
+            pending_count_.fetch_add(1, std::memory_order_relaxed);
+            if(auto* worker = get_current_worker())
+            {
+                worker->deque.push(task);
+            }
+            else
+            {
+                std::lock_guard lock{ injection_mutex_ };
+                injection_queue_.push_back(task);
+                injection_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+            wake_worker();
+            return true;
+        }
+
+        virtual bool currentThreadInExecutor() const override
+        {
+            return get_current_worker() != nullptr;
+        }
+
+        virtual async_simple::ExecutorStat stat() const override
+        {
+            async_simple::ExecutorStat result;
+            result.pendingTaskCount = pending_count_.load(std::memory_order_relaxed);
+            return result;
+        }
+
+        virtual size_t currentContextId() const override
+        {
+            return get_current_worker_index();
+        }
+
+        virtual uint32_t get_worker_count() const override
+        {
+            return static_cast<uint32_t>(workers_.size());
+        }
+
+        virtual uint32_t get_current_worker_index() const override
+        {
+            auto const* worker = get_current_worker();
+            return worker ? worker->index : invalid_index_value();
+        }
+
+    private:
+        worker_t* get_current_worker() const noexcept
+        {
+            return current_worker_.executor == this ? current_worker_.worker : nullptr;
+        }
+
+        void wake_worker()
+        {
+            // pairs with the fence of a parking worker, either it sees the new task or we see it parked
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(wake_parked_worker())
+            {
+                return;
+            }
+
+            // all of our workers are busy, lend the task to an idle core of a borrower
+            borrowers_.any_of([](work_stealing_executor_impl* borrower)
+                {
+                    return !borrower->stopping_.load(std::memory_order_relaxed) && borrower->wake_parked_worker();
+                });
+        }
+
+        bool wake_parked_worker()
+        {
+            if(parked_count_.load(std::memory_order_relaxed) == 0)
+            {
+                return false;
+            }
+            wake_epoch_.fetch_add(1, std::memory_order_relaxed);
+            wake_epoch_.notify_one();
+            return true;
+        }
+
+        void run_worker(worker_t& worker, std::optional<uint32_t> core)
+        {
+            current_worker_ = { this, &worker };
+            if(core)
+            {
+                pin_current_thread(*core);
+            }
+
+            uint32_t idle_rounds = 0;
+            for(;;)
+            {
+                if(auto* task = find_task(worker))
+                {
+                    run_task(task);
+                    idle_rounds = 0;
+                    continue;
+                }
+
+                if(++idle_rounds < spin_count_)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                idle_rounds = 0;
+
+                // park until a task is scheduled, checking again after announcing so no wake up is lost
+                auto const epoch = wake_epoch_.load(std::memory_order_relaxed);
+                parked_count_.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(has_visible_task())
+                {
+                    parked_count_.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+                if(stopping_.load(std::memory_order_relaxed))
+                {
+                    parked_count_.fetch_sub(1, std::memory_order_relaxed);
+                    break;
+                }
+                wake_epoch_.wait(epoch, std::memory_order_relaxed);
+                parked_count_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            current_worker_ = {};
+        }
+
+        // own deque first, then the injection queue, then steal from the other workers starting at a random one,
+        // and borrow from the neighbors last, a stopping executor no longer borrows
+        task_t* find_task(worker_t& worker)
+        {
+            if(auto task = worker.deque.pop())
+            {
+                return *task;
+            }
+
+            if(auto* task = take_injected_task())
+            {
+                return task;
+            }
+
+            worker.random_state ^= worker.random_state << 13;
+            worker.random_state ^= worker.random_state >> 17;
+            worker.random_state ^= worker.random_state << 5;
+            if(auto* task = steal_task(worker.random_state, &worker))
+            {
+                return task;
+            }
+
+            if(stopping_.load(std::memory_order_relaxed))
+            {
+                return nullptr;
+            }
+            task_t* task = nullptr;
+            neighbors_.any_of([&](work_stealing_executor_impl* neighbor)
+                {
+                    task = neighbor->lend_task(worker.random_state);
+                    return task != nullptr;
+                });
+            return task;
+        }
+
+        task_t* take_injected_task()
+        {
+            if(injection_count_.load(std::memory_order_relaxed) == 0)
+            {
+                return nullptr;
+            }
+
+            std::lock_guard lock{ injection_mutex_ };
+            if(injection_queue_.empty())
+            {
+                return nullptr;
+            }
+            auto* task = injection_queue_.front();
+            injection_queue_.pop_front();
+            injection_count_.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+
+        task_t* steal_task(uint32_t random, worker_t const* thief)
+        {
+            auto const worker_count = static_cast<uint32_t>(workers_.size());
+            auto const first_victim = random % worker_count;
+            for(uint32_t loop = 0; loop < worker_count; ++loop)
+            {
+                auto& victim = *workers_[(first_victim + loop) % worker_count];
+                if(&victim == thief)
+                {
+                    continue;
+                }
+                if(auto task = victim.deque.steal())
+                {
+                    return *task;
+                }
+            }
+            return nullptr;
+        }
+
+        // called by a worker of a borrower, the spawned tasks are the cheapest to move, the injected ones go next
+        task_t* lend_task(uint32_t random)
+        {
+            if(auto* task = steal_task(random, nullptr))
+            {
+                return task;
+            }
+            return take_injected_task();
+        }
+
+        bool has_own_visible_task() const
+        {
+            return injection_count_.load(std::memory_order_relaxed) > 0 ||
+                std::ranges::any_of(workers_, [](auto const& worker) { return !worker->deque.empty(); });
+        }
+
+        bool has_visible_task() const
+        {
+            return has_own_visible_task() || (!stopping_.load(std::memory_order_relaxed) &&
+                neighbors_.any_of([](work_stealing_executor_impl const* neighbor) { return neighbor->has_own_visible_task(); }));
+        }
+
+        static void run_task(task_t* task)
+        {
+            std::unique_ptr<task_t> owned_task{ task };
+            owned_task->func();
+            owned_task->owner->pending_count_.fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    thread_local work_stealing_executor_impl::current_worker_t work_stealing_executor_impl::current_worker_{};
+
+    work_stealing_executor* work_stealing_executor::create_instance(work_stealing_executor_options const& options)
+    {
+        return new work_stealing_executor_impl{ options };
+    }
+}